@@ -0,0 +1,323 @@
+// Soak test: runs kitchentodo against a scratch store and drives thousands of add/toggle/clear/rename
+// cycles through its control socket, failing if the process RSS or its X window count keeps growing.
+//
+//   soak_driver <path to kitchentodo> [cycles]
+//
+// Needs an X server; the soak target runs it under xvfb-run.
+
+#define _GNU_SOURCE // mkdtemp
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xlib.h>
+
+#define MAX_PATH_LEN 512
+#define HOME_PATH_LEN 64   // a mkdtemp () directory under /tmp
+#define STORE_PATH_LEN 128 // HOME_PATH_LEN plus "/.local/share/kitchentodo"
+#define DEFAULT_CYCLES 2000
+#define WARMUP_CYCLES 100
+#define ITEMS_PER_CYCLE 20
+#define SAMPLE_INTERVAL 250
+#define RSS_SLACK_KB 2048 // allocator noise; a real leak blows through this long before the end
+#define STARTUP_TIMEOUT_S 10
+
+typedef struct _soak_sample_t {
+    long          rss_kb;
+    unsigned      num_windows;
+} soak_sample_t;
+
+static pid_t    g_todo_pid = 0;
+static char     g_home_path[HOME_PATH_LEN];
+static char     g_store_path[STORE_PATH_LEN];
+static char     g_socket_path[MAX_PATH_LEN];
+static Display *g_display = NULL;
+
+void stop_todo_process ()
+{
+    if (g_todo_pid > 0) {
+        kill (g_todo_pid, SIGTERM);
+        waitpid (g_todo_pid, NULL, 0);
+        g_todo_pid = 0;
+    }
+}
+
+void fail (const char *message)
+{
+    fprintf (stderr, "soak: FAIL: %s\n", message);
+    stop_todo_process ();
+    exit (1);
+}
+
+long read_rss_kb (pid_t pid)
+{
+    char status_path[64];
+    snprintf (status_path, sizeof (status_path), "/proc/%d/status", (int) pid);
+
+    FILE *fp = fopen (status_path, "r");
+    if (!fp) {
+        fail ("kitchentodo exited");
+    }
+
+    long rss_kb = -1;
+    char line[256];
+    while (fgets (line, sizeof (line), fp) != NULL) {
+        if (sscanf (line, "VmRSS: %ld kB", &rss_kb) == 1) break;
+    }
+
+    fclose (fp);
+    return rss_kb;
+}
+
+// Every widget with a window (toggles, pooled or not, scrollers, dialog shells) shows up here. The
+// server only has kitchentodo as a client, so the whole tree is ours.
+unsigned count_windows (Window window)
+{
+    Window root_return, parent_return;
+    Window *children = NULL;
+    unsigned int num_children = 0;
+    if (!XQueryTree (g_display, window, &root_return, &parent_return, &children, &num_children)) {
+        return 0;
+    }
+
+    unsigned count = num_children;
+    for (unsigned int i = 0; i < num_children; i++) {
+        count += count_windows (children[i]);
+    }
+
+    if (children) {
+        XFree (children);
+    }
+
+    return count;
+}
+
+soak_sample_t take_sample ()
+{
+    soak_sample_t sample = {
+        .rss_kb = read_rss_kb (g_todo_pid),
+        .num_windows = count_windows (DefaultRootWindow (g_display)),
+    };
+    return sample;
+}
+
+int connect_control_socket ()
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy (addr.sun_path, g_socket_path, sizeof (addr.sun_path) - 1);
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        fail ("unable to create socket");
+    }
+
+    if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0) {
+        close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Sends one batch and waits for kitchentodo to apply it. Returns false if any command failed.
+bool try_batch (const char *batch)
+{
+    int fd = connect_control_socket ();
+    if (fd == -1) {
+        fail ("unable to connect to control socket");
+    }
+
+    size_t batch_len = strlen (batch);
+    size_t sent = 0;
+    while (sent < batch_len) {
+        ssize_t result = write (fd, batch + sent, batch_len - sent);
+        if (result <= 0) {
+            fail ("unable to write batch");
+        }
+        sent += result;
+    }
+    shutdown (fd, SHUT_WR);
+
+    char reply[4096];
+    size_t reply_len = 0;
+    ssize_t result = 0;
+    while ((result = read (fd, reply + reply_len, sizeof (reply) - reply_len - 1)) > 0) {
+        reply_len += result;
+    }
+    reply[reply_len] = '\0';
+    close (fd);
+
+    return strncmp (reply, "ok ", 3) == 0;
+}
+
+void send_batch (const char *batch)
+{
+    if (!try_batch (batch)) {
+        fail ("batch rejected");
+    }
+}
+
+void run_cycle (unsigned cycle)
+{
+    // One list, addressed by id so renames don't matter
+    char batch[ITEMS_PER_CYCLE * 128];
+    size_t batch_len = 0;
+
+    for (unsigned int i = 0; i < ITEMS_PER_CYCLE; i++) {
+        batch_len += snprintf (batch + batch_len, sizeof (batch) - batch_len,
+                               "add\t1\tsoak %u.%u\tquantity: %u\n", cycle, i, i + 1);
+    }
+    send_batch (batch);
+
+    // Toggle everything on, some back off and on again, then clear
+    batch_len = 0;
+    for (unsigned int i = 0; i < ITEMS_PER_CYCLE; i++) {
+        batch_len += snprintf (batch + batch_len, sizeof (batch) - batch_len,
+                               "complete\t1\tsoak %u.%u\n", cycle, i);
+        if (i % 3 == 0) {
+            batch_len += snprintf (batch + batch_len, sizeof (batch) - batch_len,
+                                   "uncomplete\t1\tsoak %u.%u\ncomplete\t1\tsoak %u.%u\n",
+                                   cycle, i, cycle, i);
+        }
+    }
+    send_batch (batch);
+    send_batch ("clear\t1\n");
+
+    // Rename behind kitchentodo's back; the store watch picks it up
+    char from_path[MAX_PATH_LEN], to_path[MAX_PATH_LEN];
+    snprintf (from_path, MAX_PATH_LEN, "%s/1 Soak %u", g_store_path, cycle % 2);
+    snprintf (to_path, MAX_PATH_LEN, "%s/1 Soak %u", g_store_path, (cycle + 1) % 2);
+    if (rename (from_path, to_path) != 0) {
+        fail ("unable to rename list");
+    }
+
+    // Item files are written under the list's name, so wait until the new one is in use.
+    // Clearing an empty list is a no-op that only succeeds once the name resolves.
+    char probe[64];
+    snprintf (probe, sizeof (probe), "clear\tSoak %u\n", (cycle + 1) % 2);
+    for (unsigned int i = 0; !try_batch (probe); i++) {
+        if (i == STARTUP_TIMEOUT_S * 100) {
+            fail ("rename was not picked up");
+        }
+
+        struct timespec delay = { .tv_sec = 0, .tv_nsec = 10 * 1000 * 1000 };
+        nanosleep (&delay, NULL);
+    }
+}
+
+void start_todo_process (const char *todo_path)
+{
+    if (mkdtemp (g_home_path) == NULL) {
+        fail ("unable to create scratch home");
+    }
+
+    // Seed the store with one list so the first rename has something to move
+    snprintf (g_store_path, STORE_PATH_LEN, "%s/.local", g_home_path);
+    mkdir (g_store_path, S_IRWXU);
+    snprintf (g_store_path, STORE_PATH_LEN, "%s/.local/share", g_home_path);
+    mkdir (g_store_path, S_IRWXU);
+    snprintf (g_store_path, STORE_PATH_LEN, "%s/.local/share/kitchentodo", g_home_path);
+    mkdir (g_store_path, S_IRWXU);
+
+    char list_path[MAX_PATH_LEN];
+    snprintf (list_path, MAX_PATH_LEN, "%s/1 Soak 0", g_store_path);
+    mkdir (list_path, S_IRWXU);
+
+    snprintf (g_socket_path, MAX_PATH_LEN, "%s/.control", g_store_path);
+
+    g_todo_pid = fork ();
+    if (g_todo_pid == 0) {
+        setenv ("HOME", g_home_path, 1);
+        execl (todo_path, todo_path, "-xrm", "*archiveAgeHours: 0", (char *) NULL);
+        _exit (127);
+    } else if (g_todo_pid < 0) {
+        fail ("fork failed");
+    }
+
+    // Wait for the control socket to come up. Send an empty batch and wait for the server to
+    // hang up, rather than hanging up on it first.
+    for (unsigned int i = 0; i < STARTUP_TIMEOUT_S * 10; i++) {
+        int fd = connect_control_socket ();
+        if (fd != -1) {
+            shutdown (fd, SHUT_WR);
+
+            char reply[64];
+            while (read (fd, reply, sizeof (reply)) > 0);
+            close (fd);
+            return;
+        }
+
+        if (waitpid (g_todo_pid, NULL, WNOHANG) == g_todo_pid) {
+            g_todo_pid = 0;
+            fail ("kitchentodo exited during startup");
+        }
+
+        struct timespec delay = { .tv_sec = 0, .tv_nsec = 100 * 1000 * 1000 };
+        nanosleep (&delay, NULL);
+    }
+
+    fail ("timed out waiting for control socket");
+}
+
+int main (int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf (stderr, "usage: %s <kitchentodo> [cycles]\n", argv[0]);
+        return 2;
+    }
+
+    unsigned num_cycles = (argc > 2) ? strtoul (argv[2], NULL, 10) : DEFAULT_CYCLES;
+    if (num_cycles <= WARMUP_CYCLES) {
+        num_cycles = WARMUP_CYCLES + 1;
+    }
+
+    // Report a dead kitchentodo instead of dying with it mid-batch
+    signal (SIGPIPE, SIG_IGN);
+
+    g_display = XOpenDisplay (NULL);
+    if (g_display == NULL) {
+        fprintf (stderr, "soak: unable to open display (run under xvfb-run)\n");
+        return 2;
+    }
+
+    snprintf (g_home_path, HOME_PATH_LEN, "/tmp/kitchentodo-soak.XXXXXX");
+    start_todo_process (argv[1]);
+
+    // Pools and caches fill up during warm-up; after that nothing should grow
+    soak_sample_t baseline = { 0 };
+    for (unsigned int cycle = 0; cycle < num_cycles; cycle++) {
+        run_cycle (cycle);
+
+        if (cycle + 1 == WARMUP_CYCLES) {
+            baseline = take_sample ();
+            printf ("soak: baseline after %u cycles: %ld kB RSS, %u windows\n",
+                    WARMUP_CYCLES, baseline.rss_kb, baseline.num_windows);
+        } else if (cycle + 1 > WARMUP_CYCLES && (cycle + 1) % SAMPLE_INTERVAL == 0) {
+            soak_sample_t sample = take_sample ();
+            printf ("soak: cycle %u: %ld kB RSS, %u windows\n", cycle + 1, sample.rss_kb, sample.num_windows);
+
+            if (sample.rss_kb > baseline.rss_kb + RSS_SLACK_KB) {
+                fail ("RSS is growing");
+            }
+
+            if (sample.num_windows > baseline.num_windows) {
+                fail ("widget count is growing");
+            }
+        }
+    }
+
+    printf ("soak: PASS (%u cycles)\n", num_cycles);
+    stop_todo_process ();
+    XCloseDisplay (g_display);
+    return 0;
+}
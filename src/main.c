@@ -1,5 +1,8 @@
+#define _GNU_SOURCE // strcasestr
+
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
@@ -8,15 +11,44 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+#include <signal.h>
 #include <unistd.h>
+#include <zlib.h>
 #include <Xm/XmAll.h>
 
 #define MAX_TODOS 128
+#define TODO_BITSET_WORDS ((MAX_TODOS + 63) / 64)
 #define MAX_LISTS 16
 #define MAX_PATH_LEN 512
-#define FS_EVENT_BUFSIZE sizeof (struct inotify_event) + NAME_MAX + 1
+#define ITEM_LINE_LEN 512 // longest line read back from an item file
+#define MAX_LABEL_LEN (ITEM_LINE_LEN - 1)
+#define FS_EVENT_BUFSIZE (16 * (sizeof (struct inotify_event) + NAME_MAX + 1))
+#define FS_WATCH_MASK (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#define FS_STORE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#define ARCHIVE_DIR_NAME ".archive"
+#define ARCHIVE_SWEEP_INTERVAL_MS (10 * 60 * 1000)
+#define ARCHIVE_LINE_LEN 1024
+#define HISTORY_MAX_RESULTS 20
+#define MAX_TEMP_STRINGS 32
+#define MAX_DUE_ENTRIES (MAX_LISTS * MAX_TODOS)
+#define MAX_DUE_TIMER_MS (60 * 60 * 1000) // re-check the wall clock at least hourly
+#define DUE_DATE_FORMAT "%Y-%m-%d %H:%M"
+#define OVERDUE_COLOR "red"
+#define CONTROL_SOCKET_NAME ".control"
+#define MAX_CONTROL_BATCH_LEN (64 * 1024)
+#define SHARED_CACHE_MAGIC 0x6b746f64 // "ktod"
+#define SHARED_CACHE_VERSION 2
+#define SHARED_CACHE_POLL_MS 250
+#define SHARED_LABEL_LEN ITEM_LINE_LEN // labels are never shortened in the cache
+#define SHARED_LIST_NAME_LEN (NAME_MAX + 1)
+#define MAX_OWN_WRITES 256
+#define OWN_WRITE_EXPIRY_S 5 // in case the event never arrives (e.g. the inotify queue overflowed)
 
 #define __unused __attribute__ ((unused))
 
@@ -24,8 +56,22 @@ typedef struct _todo_item_t {
     bool          complete;
     char         *label_string;
     unsigned long id;
+
+    // Metadata, stored as "key: value" lines after the label
+    time_t        due_time;   // 0 if none
+    unsigned      quantity;   // 0 if none
+    int           priority;
+    char         *extra_metadata; // lines we don't understand, newline terminated, written back as is
 } todo_item_t;
 
+// Due date index entry. Entries are not removed when an item changes; stale ones are
+// skipped when they reach the top of the heap.
+typedef struct _due_entry_t {
+    time_t        due_time;
+    unsigned long list_id;
+    unsigned long item_id;
+} due_entry_t;
+
 typedef struct _todo_list_t {
     XmString      list_name;
     Widget        list_widget;
@@ -34,13 +80,68 @@ typedef struct _todo_list_t {
     unsigned long last_item_id;
 
     unsigned long id;
+
+    // Items, struct-of-arrays: index i of every array below is the same item.
+    // Use todo_list_get_item ()/todo_list_set_item () for a todo_item_t view of one.
+    unsigned long item_ids[MAX_TODOS];
+    uint64_t      complete_bits[TODO_BITSET_WORDS]; // bits past num_todo_items are always clear
+    char         *item_labels[MAX_TODOS];
     Widget        list_toggle_widgets[MAX_TODOS];
-    todo_item_t   todo_items[MAX_TODOS];
     unsigned      num_todo_items;
 
-    int           watch_descriptor;
+    // Item metadata, only touched when sorting, highlighting or writing items
+    time_t        item_due_times[MAX_TODOS];
+    unsigned      item_quantities[MAX_TODOS];
+    int           item_priorities[MAX_TODOS];
+    char         *item_extra_metadata[MAX_TODOS];
+
+    // Unmanaged toggle buttons from removed items, reused by add_todo
+    Widget        free_toggle_widgets[MAX_TODOS];
+    unsigned      num_free_toggle_widgets;
+
+    int           watch_descriptor; // main loop only; the watcher thread uses g_list_watches
+
+    bool          changed;           // tab count (and shared cache) need refreshing
+    unsigned long shared_generation; // follower: generation last applied from the shared cache
 } todo_list_t;
 
+// Parsed lists as published by the instance that owns the store, for other instances
+// on the same host to map instead of loading and watching the store themselves.
+typedef struct _shared_item_t {
+    unsigned long id;
+    bool          complete;
+    time_t        due_time;
+    unsigned      quantity;
+    int           priority;
+    char          label_string[SHARED_LABEL_LEN];
+} shared_item_t;
+
+typedef struct _shared_list_t {
+    unsigned long id;         // 0 if the slot is free
+    unsigned long generation; // cache generation when this list was last published
+    unsigned long last_item_id;
+    char          list_name[SHARED_LIST_NAME_LEN];
+    unsigned      num_todo_items;
+    shared_item_t todo_items[MAX_TODOS];
+} shared_list_t;
+
+typedef struct _shared_cache_t {
+    uint32_t        magic;
+    uint32_t        version;
+    pthread_mutex_t lock;
+    pid_t           owner_pid;
+    unsigned long   generation;
+    shared_list_t   lists[MAX_LISTS];
+} shared_cache_t;
+
+typedef struct _app_resources_t {
+    // Completed items older than this move to the archive. 0 disables automatic archiving.
+    int           archive_age_hours;
+
+    // Share parsed lists with other instances on this host through shared memory
+    Boolean       shared_cache;
+} app_resources_t;
+
 typedef struct _app_state_t {
     XtAppContext  app;
     Widget        root_widget;
@@ -53,42 +154,168 @@ typedef struct _app_state_t {
 
     todo_list_t  *selected_list;
 
+    // Move to List: the dialogs aren't modal, so what they show is remembered by id when
+    // they open rather than read back from the selected list when OK is pressed
+    unsigned long moving_list_id;
+    unsigned long moving_item_id;
+    unsigned long move_item_ids[MAX_TODOS];          // rows of the item dialog
+    unsigned long move_destination_ids[MAX_LISTS];   // rows of the destination dialog
+    unsigned      num_move_destinations;
+
+    app_resources_t resources;
+
+    // Min-heap of upcoming due dates across all lists, driven by a single timer
+    due_entry_t   due_heap[MAX_DUE_ENTRIES];
+    unsigned      num_due_entries;
+    XtIntervalId  due_timer;
+    time_t        due_timer_deadline;
+
+    bool          sort_by_due;
+
+    // Dialogs are created on first use and reused afterwards
+    Widget        textfield_dialog;
+    Widget        delete_list_dialog;
+    Widget        move_item_dialog;
+    Widget        move_list_dialog;
+    Widget        history_dialog;
+
     pthread_t     file_watch_thread;
     int           file_watch_inotify_fd;
+    int           store_watch_descriptor;
+    bool          store_reload_pending;
+
+    int           control_socket_fd;
+    char          control_socket_path[MAX_PATH_LEN];
+
+    shared_cache_t *shared_cache;
+    bool          shared_cache_owner;
+    bool          list_changes_pending;
+    unsigned long shared_cache_generation; // follower: last generation applied
 } app_state_t;
 
+// A client of the control socket. The whole batch is read before any of it is applied.
+typedef struct _control_connection_t {
+    int           fd;
+    XtInputId     input_id;
+    char         *buffer;
+    size_t        buffer_len;
+    size_t        buffer_capacity;
+} control_connection_t;
+
+// An IN_MOVED_FROM/IN_MOVED_TO pair, handed from the watcher thread to the main loop.
+// Lists are referred to by id: the list array may be compacted before the event is handled.
+typedef struct _item_move_event_t {
+    unsigned long from_list_id;
+    unsigned long to_list_id;
+    unsigned long from_id;
+    unsigned long to_id;
+} item_move_event_t;
+
+// A watched list directory. The watcher thread looks lists up here rather than in
+// g_app_state.todo_lists, which the main loop compacts as lists come and go.
+typedef struct _list_watch_t {
+    int           watch_descriptor;
+    unsigned long list_id;
+    bool          reload_pending; // set by the watcher thread, cleared on the main loop
+} list_watch_t;
+
+// A change this instance made to an item file, so the watcher can skip the resulting event
+typedef struct _own_write_t {
+    unsigned long list_id;
+    unsigned long item_id;
+    uint32_t      mask;    // IN_CLOSE_WRITE or IN_DELETE
+    time_t        expires;
+} own_write_t;
+
 static app_state_t g_app_state = { 0 };
 
+// XmStrings handed to widgets that copy them, freed in one go by free_temp_strings ()
+static XmString g_temp_strings[MAX_TEMP_STRINGS];
+static unsigned g_num_temp_strings = 0;
+
+// Watched list directories, shared with the watcher thread
+static list_watch_t    g_list_watches[MAX_LISTS];
+static unsigned        g_num_list_watches = 0;
+static pthread_mutex_t g_list_watches_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Item files this instance has just written or deleted, shared with the watcher thread
+static own_write_t     g_own_writes[MAX_OWN_WRITES];
+static unsigned        g_num_own_writes = 0;
+static pthread_mutex_t g_own_writes_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static XtResource g_app_resources[] = {
+    { "archiveAgeHours", "ArchiveAgeHours", XtRInt, sizeof (int),
+      XtOffsetOf (app_resources_t, archive_age_hours), XtRImmediate, (XtPointer) 24 },
+    { "sharedCache", "SharedCache", XtRBoolean, sizeof (Boolean),
+      XtOffsetOf (app_resources_t, shared_cache), XtRImmediate, (XtPointer) False },
+};
+
+// Called for each archived record, oldest first
+typedef void (*archive_record_proc) (time_t completed_time, const char *label_string, void *context);
+
 // File menu
 enum {
     FILE_MENU_ADD_ITEM,
+    FILE_MENU_MOVE_ITEM,
     FILE_MENU_CLEAR_COMPLETED,
     FILE_MENU_QUIT,
 
     FILE_MENU_NUM_ITEMS
 };
 
+// View menu
+enum {
+    VIEW_MENU_SORT_BY_DUE,
+
+    VIEW_MENU_NUM_ITEMS
+};
+
 // Lists menu
 enum {
     LISTS_MENU_CREATE_LIST,
     LISTS_MENU_DELETE_LIST,
     LISTS_MENU_RENAME_LIST,
+    LISTS_MENU_SEARCH_HISTORY,
 
     LISTS_MENU_NUM_ITEMS
 };
 
 // Action prototypes
 void add_todo (todo_list_t *list, todo_item_t item);
+void update_todo (todo_list_t *list, unsigned index, todo_item_t item);
+int  todo_item_index (todo_list_t *list, unsigned long id);
+bool todo_item_equal (todo_item_t a, todo_item_t b);
+void remove_todo_at_index (todo_list_t *list, unsigned index);
+int  move_todo_item (todo_list_t *from_list, unsigned index, todo_list_t *to_list);
 void clear_completed (todo_list_t *list);
+void archive_completed (todo_list_t *list, time_t min_age);
+int  todo_list_query_archive (todo_list_t *list, const char *match, archive_record_proc proc, void *context);
+
+void expect_own_write (todo_list_t *list, unsigned long item_id, uint32_t mask);
+bool consume_own_write (unsigned long list_id, unsigned long item_id, uint32_t mask);
+void schedule_list_reload (unsigned long list_id);
+void unwatch_todo_list (todo_list_t *list);
 
 void add_todo_list (todo_list_t list);
+void forget_todo_list (todo_list_t *list);
+todo_list_t* todo_list_for_id (unsigned long id);
+
+bool shared_cache_is_follower (void);
+void mark_todo_list_changed (todo_list_t *list);
+void update_todo_list_tab (todo_list_t *list);
+void shared_cache_remove_list (unsigned long list_id);
+void initialize_control_socket (void);
 void reload_todo_lists (void);
 
 // Callbacks
 void file_menu_callback (Widget, XtPointer, XtPointer);
 void add_menu_callback (Widget, XtPointer, XtPointer);
 void add_menu_completion (Widget, XtPointer, XtPointer);
+void move_menu_callback (Widget, XtPointer, XtPointer);
+void move_item_selected (Widget, XtPointer, XtPointer);
+void move_list_selected (Widget, XtPointer, XtPointer);
 void toggle_item_callback (Widget, XtPointer, XtPointer);
+void view_menu_callback (Widget, XtPointer, XtPointer);
 void notebook_page_changed_callback (Widget, XtPointer, XtPointer);
 
 void list_menu_callback (Widget, XtPointer, XtPointer);
@@ -96,6 +323,102 @@ void add_list_callback (Widget, XtPointer, XtPointer);
 void add_list_completion (Widget, XtPointer, XtPointer);
 void delete_list_completion (Widget, XtPointer, XtPointer);
 void rename_list_completion (Widget, XtPointer, XtPointer);
+void search_history_callback (Widget, XtPointer, XtPointer);
+void search_history_completion (Widget, XtPointer, XtPointer);
+
+XmString temp_string (const char *text)
+{
+    XmString string = XmStringCreateSimple ((char *) text);
+    if (g_num_temp_strings < MAX_TEMP_STRINGS) {
+        g_temp_strings[g_num_temp_strings++] = string;
+    }
+
+    return string;
+}
+
+void free_temp_strings ()
+{
+    for (unsigned int i = 0; i < g_num_temp_strings; i++) {
+        XmStringFree (g_temp_strings[i]);
+    }
+
+    g_num_temp_strings = 0;
+}
+
+bool todo_list_item_is_complete (todo_list_t *list, unsigned index)
+{
+    return (list->complete_bits[index / 64] >> (index % 64)) & 1;
+}
+
+void todo_list_set_item_complete (todo_list_t *list, unsigned index, bool complete)
+{
+    uint64_t mask = (uint64_t) 1 << (index % 64);
+    if (complete) {
+        list->complete_bits[index / 64] |= mask;
+    } else {
+        list->complete_bits[index / 64] &= ~mask;
+    }
+}
+
+unsigned todo_list_count_complete (todo_list_t *list)
+{
+    unsigned count = 0;
+    for (unsigned int w = 0; w < TODO_BITSET_WORDS; w++) {
+        count += __builtin_popcountll (list->complete_bits[w]);
+    }
+
+    return count;
+}
+
+// Label and extra metadata are borrowed from the list
+todo_item_t todo_list_get_item (todo_list_t *list, unsigned index)
+{
+    todo_item_t item = {
+        .complete = todo_list_item_is_complete (list, index),
+        .label_string = list->item_labels[index],
+        .id = list->item_ids[index],
+        .due_time = list->item_due_times[index],
+        .quantity = list->item_quantities[index],
+        .priority = list->item_priorities[index],
+        .extra_metadata = list->item_extra_metadata[index],
+    };
+
+    return item;
+}
+
+// Label and extra metadata ownership passes to the list
+void todo_list_set_item (todo_list_t *list, unsigned index, todo_item_t item)
+{
+    todo_list_set_item_complete (list, index, item.complete);
+    list->item_labels[index] = item.label_string;
+    list->item_ids[index] = item.id;
+    list->item_due_times[index] = item.due_time;
+    list->item_quantities[index] = item.quantity;
+    list->item_priorities[index] = item.priority;
+    list->item_extra_metadata[index] = item.extra_metadata;
+}
+
+void todo_item_free (todo_item_t item)
+{
+    free (item.label_string);
+    free (item.extra_metadata);
+}
+
+// Copies item src (and its toggle) over dst, for closing holes
+void todo_list_move_item (todo_list_t *list, unsigned dst, unsigned src)
+{
+    todo_list_set_item (list, dst, todo_list_get_item (list, src));
+    list->list_toggle_widgets[dst] = list->list_toggle_widgets[src];
+}
+
+// Clears every completion bit at or past count
+void todo_list_truncate_complete_bits (todo_list_t *list, unsigned count)
+{
+    for (unsigned int w = count / 64; w < TODO_BITSET_WORDS; w++) {
+        unsigned first_bit = (w == count / 64) ? count % 64 : 0;
+        list->complete_bits[w] &= ((uint64_t) 1 << first_bit) - 1;
+    }
+}
 
 void initialize_store_if_necessary ()
 {
@@ -116,15 +439,69 @@ void initialize_store_if_necessary ()
             exit (1);
         }
     }
+
+    // Archives live beside the lists; dot entries are skipped when scanning for lists
+    char archive_path[MAX_PATH_LEN];
+    snprintf (archive_path, MAX_PATH_LEN, "%s/%s", g_app_state.store_path, ARCHIVE_DIR_NAME);
+    if (stat (archive_path, &stat_buf) != 0) {
+        mkdir (archive_path, S_IRWXU);
+    }
 }
 
-int parse_todo_item_at_path (const char *path, todo_item_t *item_out)
+void append_extra_metadata (const char *line, todo_item_t *item_out)
 {
-    struct stat stat_buf;
-    if (stat (path, &stat_buf) != 0) {
-        return -1;
+    size_t existing_len = item_out->extra_metadata ? strlen (item_out->extra_metadata) : 0;
+    size_t line_len = strlen (line);
+
+    item_out->extra_metadata = realloc (item_out->extra_metadata, existing_len + line_len + 2);
+    memcpy (item_out->extra_metadata + existing_len, line, line_len);
+    item_out->extra_metadata[existing_len + line_len] = '\n';
+    item_out->extra_metadata[existing_len + line_len + 1] = '\0';
+}
+
+// Lines we don't recognize are kept in extra_metadata, so other tools' keys survive a rewrite
+void parse_todo_item_metadata (const char *line, todo_item_t *item_out)
+{
+    const char *separator = strchr (line, ':');
+    if (separator == NULL) {
+        append_extra_metadata (line, item_out);
+        return;
+    }
+
+    char key[32];
+    snprintf (key, sizeof (key), "%.*s", (int) (separator - line), line);
+
+    const char *value = separator + 1;
+    while (*value == ' ') value++;
+
+    if (strcmp (key, "due") == 0) {
+        struct tm tm = { 0 };
+        const char *end = strptime (value, DUE_DATE_FORMAT, &tm);
+        if (end == NULL) {
+            // Date only: due by the end of the day
+            memset (&tm, 0, sizeof (tm));
+            end = strptime (value, "%Y-%m-%d", &tm);
+            tm.tm_hour = 23;
+            tm.tm_min = 59;
+        }
+
+        if (end != NULL) {
+            tm.tm_isdst = -1;
+            item_out->due_time = mktime (&tm);
+        } else {
+            append_extra_metadata (line, item_out);
+        }
+    } else if (strcmp (key, "quantity") == 0) {
+        item_out->quantity = strtoul (value, NULL, 10);
+    } else if (strcmp (key, "priority") == 0) {
+        item_out->priority = strtol (value, NULL, 10);
+    } else {
+        append_extra_metadata (line, item_out);
     }
+}
 
+int parse_todo_item_at_path (const char *path, todo_item_t *item_out)
+{
     enum {
         COMPLETION_STATE,
         TODO_NAME,
@@ -132,32 +509,36 @@ int parse_todo_item_at_path (const char *path, todo_item_t *item_out)
     } read_state = COMPLETION_STATE;
 
     FILE *fp = fopen (path, "r");
-    const size_t buf_size = 512;
-    char buf[buf_size];
-    int read_result = 0;
-    while ( (read_result = fread (buf, 1, buf_size, fp)) > 0 ) {
-        char *line;
-        char *str = buf;
-        while ( (line = strtok (str, "\n")) != NULL ) {
-            str = NULL; // for each successive call to strtok
-
-            switch (read_state) {
-            case COMPLETION_STATE:
-                item_out->complete = (line[0] == '1');
-                break;
-            case TODO_NAME:
-                item_out->label_string = malloc (sizeof (char) * strlen (line));
-                strcpy (item_out->label_string, line);
-                break;
-            default:
-                break;
-            }
+    if (!fp) {
+        return -1;
+    }
 
-            read_state++;
+    char line[ITEM_LINE_LEN];
+    while (fgets (line, ITEM_LINE_LEN, fp) != NULL) {
+        line[strcspn (line, "\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        switch (read_state) {
+        case COMPLETION_STATE:
+            item_out->complete = (line[0] == '1');
+            read_state = TODO_NAME;
+            break;
+        case TODO_NAME:
+            item_out->label_string = strdup (line);
+            read_state = METADATA;
+            break;
+        case METADATA:
+            parse_todo_item_metadata (line, item_out);
+            break;
         }
     }
 
     fclose (fp);
+
+    if (item_out->label_string == NULL) {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -170,6 +551,7 @@ void todo_list_get_path (todo_list_t *list, char *out_path, size_t out_path_len)
                                              NULL, 0, XmOUTPUT_ALL);
 
     snprintf (out_path, out_path_len, "%s/%lu %s", g_app_state.store_path, list->id, list_name_chr);
+    XtFree (list_name_chr);
 }
 
 void todo_item_get_path (todo_list_t *list, todo_item_t item, char *out_path, size_t out_path_len)
@@ -179,11 +561,28 @@ void todo_item_get_path (todo_list_t *list, todo_item_t item, char *out_path, si
     snprintf (out_path, out_path_len, "%s/%lu", store_path, item.id);
 }
 
+void todo_list_get_archive_path (todo_list_t *list, char *out_path, size_t out_path_len)
+{
+    // Keyed by id only so the archive survives renaming the list
+    snprintf (out_path, out_path_len, "%s/%s/%lu.gz", g_app_state.store_path, ARCHIVE_DIR_NAME, list->id);
+}
+
 int write_todo_item_to_store (todo_list_t *list, todo_item_t item)
 {
     char filename[MAX_PATH_LEN];
     todo_item_get_path (list, item, filename, MAX_PATH_LEN);
 
+    // Followers get items from the shared cache, which doesn't carry extra metadata;
+    // keep whatever is in the file
+    const char *extra_metadata = item.extra_metadata;
+    todo_item_t on_disk_item = { 0 };
+    if (shared_cache_is_follower () && parse_todo_item_at_path (filename, &on_disk_item) == 0) {
+        extra_metadata = on_disk_item.extra_metadata;
+    }
+
+    // Already applied in memory, the watcher doesn't need to rescan the list for it
+    expect_own_write (list, item.id, IN_CLOSE_WRITE);
+
     FILE *fp = fopen (filename, "w");
     if (!fp) {
         fprintf (stderr, "Unable to open file for writing: %s\n", filename);
@@ -195,7 +594,26 @@ int write_todo_item_to_store (todo_list_t *list, todo_item_t item)
         item.label_string
     );
 
+    if (item.due_time != 0) {
+        char due_string[32];
+        strftime (due_string, sizeof (due_string), DUE_DATE_FORMAT, localtime (&item.due_time));
+        fprintf (fp, "due: %s\n", due_string);
+    }
+
+    if (item.quantity != 0) {
+        fprintf (fp, "quantity: %u\n", item.quantity);
+    }
+
+    if (item.priority != 0) {
+        fprintf (fp, "priority: %d\n", item.priority);
+    }
+
+    if (extra_metadata != NULL) {
+        fputs (extra_metadata, fp);
+    }
+
     fclose (fp);
+    todo_item_free (on_disk_item);
     return 0;
 }
 
@@ -219,8 +637,8 @@ void delete_todo_list (todo_list_t *list)
     char filepath[MAX_PATH_LEN];
     todo_list_get_path (list, filepath, MAX_PATH_LEN);
 
-    // Stop watching
-    inotify_rm_watch (g_app_state.file_watch_inotify_fd, list->watch_descriptor);
+    // Stop watching before emptying the directory
+    unwatch_todo_list (list);
 
     // Delete all sub items
     DIR *dir = opendir (filepath);
@@ -234,18 +652,40 @@ void delete_todo_list (todo_list_t *list)
         }
 
         rmdir (filepath);
+
+        todo_list_get_archive_path (list, filepath, MAX_PATH_LEN);
+        unlink (filepath);
     } else { 
         fprintf (stderr, "List does not exist\n");
 	return;
     }
 
-    // Remove widgets
-    XtUnmanageChild (list->tab_button);
-    XtUnmanageChild (list->list_widget);
+    forget_todo_list (list);
+}
+
+// Drops a list from memory and the notebook without touching the store
+void forget_todo_list (todo_list_t *list)
+{
+    shared_cache_remove_list (list->id);
+    unwatch_todo_list (list);
+
+    // Remove widgets; destroying the scrolled window takes the RowColumn and its toggles with it
+    XtDestroyWidget (list->tab_button);
+    XtDestroyWidget (XtParent (list->list_widget));
+
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        todo_item_free (todo_list_get_item (list, i));
+    }
+    XmStringFree (list->list_name);
+
+    // Both pointers are into the array that is about to shift, so go by id
+    unsigned long list_id = list->id;
+    bool was_selected = (g_app_state.selected_list == list);
+    unsigned long selected_list_id = g_app_state.selected_list ? g_app_state.selected_list->id : 0;
 
     bool found_list = false;
     for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
-        if (g_app_state.todo_lists[i].id == list->id) {
+        if (g_app_state.todo_lists[i].id == list_id) {
             // Move up
             for (unsigned int j = i; j < g_app_state.num_todo_lists - 1; j++) {
                 g_app_state.todo_lists[j] = g_app_state.todo_lists[j + 1];
@@ -258,22 +698,60 @@ void delete_todo_list (todo_list_t *list)
 
     if (found_list) {
         g_app_state.num_todo_lists -= 1;
+        if (g_app_state.num_todo_lists == 0) {
+            g_app_state.selected_list = NULL;
+            return;
+        }
+
+        // Lists forgotten in the background (store reloads, shared cache syncs) leave the
+        // page alone
+        if (!was_selected && selected_list_id != 0) {
+            g_app_state.selected_list = todo_list_for_id (selected_list_id);
+            return;
+        }
 
         // Set the current page to the last page
         unsigned int last_page = 0;
-        XtVaGetValues (g_app_state.todo_lists[g_app_state.num_todo_lists - 1].tab_button, XmNpageNumber, &last_page, NULL);
+        todo_list_t *last_list = &g_app_state.todo_lists[g_app_state.num_todo_lists - 1];
+        XtVaGetValues (last_list->tab_button, XmNpageNumber, &last_page, NULL);
         XtVaSetValues (g_app_state.notebook, XmNcurrentPageNumber, last_page, NULL);
+        g_app_state.selected_list = last_list;
     }
 }
 
+// Tab reads "<name>  <done>/<total>"
+void update_todo_list_tab (todo_list_t *list)
+{
+    char *list_name_chr = (char *) XmStringUnparse (list->list_name,
+                                                    NULL,
+                                                    XmCHARSET_TEXT,
+                                                    XmCHARSET_TEXT,
+                                                    NULL, 0, XmOUTPUT_ALL);
+
+    char tab_label[MAX_PATH_LEN];
+    snprintf (tab_label, sizeof (tab_label), "%s  %u/%u",
+              list_name_chr, todo_list_count_complete (list), list->num_todo_items);
+    XtFree (list_name_chr);
+
+    XmString tab_string = XmStringCreateSimple (tab_label);
+    XtVaSetValues (list->tab_button, XmNlabelString, tab_string, NULL);
+    XmStringFree (tab_string);
+}
+
+void set_todo_list_name (todo_list_t *list, XmString new_name)
+{
+    XmStringFree (list->list_name);
+    list->list_name = XmStringCopy (new_name);
+    update_todo_list_tab (list);
+    mark_todo_list_changed (list);
+}
+
 void rename_todo_list (todo_list_t *list, XmString new_name)
 {
     char from_filepath[MAX_PATH_LEN];
     todo_list_get_path (list, from_filepath, MAX_PATH_LEN);
 
-    XmStringFree (list->list_name);
-    list->list_name = XmStringCopy (new_name);
-    XtVaSetValues (list->tab_button, XmNlabelString, new_name, NULL);
+    set_todo_list_name (list, new_name);
 
     char to_filepath[MAX_PATH_LEN];
     todo_list_get_path (list, to_filepath, MAX_PATH_LEN);
@@ -281,25 +759,32 @@ void rename_todo_list (todo_list_t *list, XmString new_name)
     rename (from_filepath, to_filepath);
 }
 
-void reload_todos_for_list (todo_list_t *list)
+// Returns -1 if the list's directory is gone, in which case the list has been forgotten
+int reload_todos_for_list (todo_list_t *list)
 {
     char store_path[MAX_PATH_LEN];
     todo_list_get_path (list, store_path, MAX_PATH_LEN);
 
     DIR *store = opendir (store_path);
     if (!store) {
-        fprintf (stderr, "could not open store path at %s\n", store_path);
-        exit (1);
+        // Deleted by another instance or from a shell; the store reload may not have run yet
+        fprintf (stderr, "List directory went away: %s\n", store_path);
+        forget_todo_list (list);
+        return -1;
     }
 
+    // Items that are no longer on disk are dropped after the scan
+    bool seen_items[MAX_TODOS] = { false };
+    unsigned num_existing_items = list->num_todo_items;
+
     int result = 0;
-    todo_item_t item = { 0 };
     char item_path[MAX_PATH_LEN];
     struct dirent *entry = NULL;
     while ( (entry = readdir (store)) != NULL ) {
         if (entry->d_name[0] == '.') continue;
         snprintf (item_path, MAX_PATH_LEN, "%s/%s", store_path, entry->d_name);
 
+        todo_item_t item = { 0 };
         result = parse_todo_item_at_path (item_path, &item);
         if (result == 0) {
             unsigned long id = strtoul (entry->d_name, NULL, 10);
@@ -310,28 +795,34 @@ void reload_todos_for_list (todo_list_t *list)
             item.id = id;
 
             // Check if todo exists first
-            todo_item_t *existing_item = NULL;
-            Widget       existing_toggle_widget = NULL;
-            for (unsigned i = 0; i < list->num_todo_items; i++) {
-                todo_item_t *item = &list->todo_items[i];
-                if (item->id == id) {
-                    existing_item = item;
-                    existing_toggle_widget = list->list_toggle_widgets[i];
-                    break;
+            int existing_index = todo_item_index (list, id);
+            if (existing_index >= 0) {
+                seen_items[existing_index] = true;
+
+                // Only touch the widget (and the tab count) for items that actually changed
+                if (todo_item_equal (todo_list_get_item (list, existing_index), item)) {
+                    todo_item_free (item);
+                } else {
+                    update_todo (list, existing_index, item);
                 }
-            }
-
-            if (existing_item != NULL) {
-                // Update item checkbox state
-                existing_item->complete = item.complete;
-                XmToggleButtonSetState (existing_toggle_widget, item.complete, false);
-            } else {
+            } else if (list->num_todo_items < MAX_TODOS) {
                 add_todo (list, item);
+            } else {
+                todo_item_free (item);
             }
         }
     }
 
     closedir (store);
+
+    for (int i = (int) num_existing_items - 1; i >= 0; i--) {
+        if (!seen_items[i]) {
+            todo_item_free (todo_list_get_item (list, i));
+            remove_todo_at_index (list, i);
+        }
+    }
+
+    return 0;
 }
 
 void reload_todo_lists ()
@@ -342,6 +833,9 @@ void reload_todo_lists ()
         exit (1);
     }
 
+    // Safe to call again at any time: known lists are kept (and renamed), vanished ones dropped
+    bool seen_lists[MAX_LISTS] = { false };
+
     char filename[MAX_PATH_LEN];
     struct dirent *entry = NULL;
     unsigned int num_todos_to_add = 0;
@@ -359,20 +853,45 @@ void reload_todo_lists ()
         }
 
         char *name = strtok (NULL, "\0");
+        if (name == NULL || id >= MAX_TODOS) continue;
+
+        XmString list_name = XmStringCreateSimple (name);
+        todo_list_t *existing_list = todo_list_for_id (id);
+        if (existing_list != NULL) {
+            seen_lists[existing_list - g_app_state.todo_lists] = true;
+            if (!XmStringCompare (existing_list->list_name, list_name)) {
+                set_todo_list_name (existing_list, list_name);
+            }
+
+            XmStringFree (list_name);
+            continue;
+        }
 
         todo_list_t *list = &sorted_lists[id]; // should be guaranteed to be unique
         list->id = id;
-        list->list_name = XmStringCreateSimple (name);
+        list->list_name = list_name;
         num_todos_to_add++;
     }
 
+    closedir (list_store);
+
+    for (int i = (int) g_app_state.num_todo_lists - 1; i >= 0; i--) {
+        if (!seen_lists[i]) {
+            forget_todo_list (&g_app_state.todo_lists[i]);
+        }
+    }
+
     unsigned int i = 0;
     while (num_todos_to_add > 0 && i < MAX_TODOS) {
         if (sorted_lists[i].list_name == NULL) {
             i++; continue;
         }
 
-        add_todo_list (sorted_lists[i]);
+        if (g_app_state.num_todo_lists < MAX_LISTS) {
+            add_todo_list (sorted_lists[i]);
+        } else {
+            XmStringFree (sorted_lists[i].list_name);
+        }
 
         i++; num_todos_to_add--;
     }
@@ -380,167 +899,1576 @@ void reload_todo_lists ()
 
     // If there are no todo lists in the store, create the default one
     if (g_app_state.num_todo_lists == 0) {
-        todo_list_t default_list = create_todo_list (XmStringCreateSimple ("Todo"));
+        todo_list_t default_list = create_todo_list (temp_string ("Todo"));
         add_todo_list (default_list);
+        free_temp_strings ();
     }
 }
 
-void add_todo (todo_list_t *list, todo_item_t item)
-{
-    unsigned int index = list->num_todo_items++;
-    list->todo_items[index] = item;
-
-    XmString label_string = XmStringCreateSimple (item.label_string);
-    Widget item_widget = XmVaCreateToggleButton (list->list_widget, "item",
-                                                 XmNlabelString, label_string,
-                                                 XmNset, item.complete,
-                                                 XmNuserData, item.id,
-                                                 NULL);
-    XtAddCallback (item_widget, XmNvalueChangedCallback, toggle_item_callback, NULL);
-    XtManageChild (item_widget);
-    XmStringFree (label_string);
-
-    list->list_toggle_widgets[index] = item_widget;
-}
-
-void add_todo_list (todo_list_t list)
+XmString todo_item_create_display_string (todo_item_t item)
 {
-    Widget notebook = g_app_state.notebook;
+    char display_string[MAX_PATH_LEN];
+    size_t len = snprintf (display_string, sizeof (display_string), "%s", item.label_string);
 
-    /* List View */
-    Widget list_scroll = XmVaCreateScrolledWindow (notebook, "scroller",
-                                                   XmNscrollingPolicy, XmAUTOMATIC,
-                                                   NULL);
-    XtManageChild (list_scroll);
+    if (item.quantity > 1 && len < sizeof (display_string)) {
+        len += snprintf (display_string + len, sizeof (display_string) - len, " (x%u)", item.quantity);
+    }
 
-    Widget list_widget = XmVaCreateRowColumn (list_scroll, "list",
-                                              XmCNumColumns, 1,
-                                              XmCIsHomogeneous, true,
-                                              XmCEntryClass, xmToggleButtonWidgetClass,
-                                              NULL);
-    XtManageChild (list_widget);
+    if (item.due_time != 0 && len < sizeof (display_string)) {
+        char due_string[32];
+        strftime (due_string, sizeof (due_string), "%a %b %e", localtime (&item.due_time));
+        snprintf (display_string + len, sizeof (display_string) - len, "  [due %s]", due_string);
+    }
 
-    list.list_widget = list_widget;
+    return XmStringCreateSimple (display_string);
+}
 
-    Widget tab = XmVaCreatePushButton (notebook, "tab",
-                                       XmNlabelString, list.list_name,
-                                       NULL);
-    XtManageChild (tab);
+bool todo_item_is_overdue (todo_item_t item, time_t now)
+{
+    return !item.complete && item.due_time != 0 && item.due_time <= now;
+}
 
-    list.tab_button = tab;
+// Due items first, soonest first; then higher priority; then insertion order
+int todo_item_compare_due (todo_list_t *list, unsigned a, unsigned b)
+{
+    time_t a_due = list->item_due_times[a];
+    time_t b_due = list->item_due_times[b];
+    if (a_due != b_due) {
+        if (a_due == 0) return 1;
+        if (b_due == 0) return -1;
+        return (a_due < b_due) ? -1 : 1;
+    }
 
-    unsigned index = g_app_state.num_todo_lists;
-    g_app_state.todo_lists[index] = list;
-    g_app_state.selected_list = &g_app_state.todo_lists[index];
-    g_app_state.num_todo_lists++;
+    int a_priority = list->item_priorities[a];
+    int b_priority = list->item_priorities[b];
+    if (a_priority != b_priority) {
+        return (a_priority > b_priority) ? -1 : 1;
+    }
 
-    reload_todos_for_list (&g_app_state.todo_lists[index]);
+    unsigned long a_id = list->item_ids[a];
+    unsigned long b_id = list->item_ids[b];
+    return (a_id < b_id) ? -1 : (a_id > b_id);
+}
 
-    // Start watching this directory for fs events
-    char list_path[MAX_PATH_LEN];
-    todo_list_get_path (&list, list_path, MAX_PATH_LEN);
-    int result = inotify_add_watch (g_app_state.file_watch_inotify_fd, list_path, IN_MODIFY);
-    if (result == -1) {
-        fprintf (stderr, "Error watching list dir: %s\n", strerror (errno));
+void update_todo_appearance (todo_list_t *list, unsigned index)
+{
+    Widget toggle_widget = list->list_toggle_widgets[index];
+    if (todo_item_is_overdue (todo_list_get_item (list, index), time (NULL))) {
+        XtVaSetValues (toggle_widget,
+                       XtVaTypedArg, XmNforeground, XmRString, OVERDUE_COLOR, strlen (OVERDUE_COLOR) + 1,
+                       NULL);
     } else {
-        g_app_state.todo_lists[index].watch_descriptor = result;
+        Pixel foreground;
+        XtVaGetValues (list->list_widget, XmNforeground, &foreground, NULL);
+        XtVaSetValues (toggle_widget, XmNforeground, foreground, NULL);
     }
 }
 
-void clear_completed (todo_list_t *list)
+// Toggles of live items always occupy the first num_todo_items positions of the RowColumn
+void update_todo_position (todo_list_t *list, unsigned index)
 {
-    static const unsigned long ID_SENTINEL = ULONG_MAX;
+    unsigned position = index;
+    if (g_app_state.sort_by_due) {
+        position = 0;
+        for (unsigned int i = 0; i < list->num_todo_items; i++) {
+            if (i != index && todo_item_compare_due (list, i, index) < 0) {
+                position++;
+            }
+        }
+    }
 
-    char filepath[MAX_PATH_LEN];
-    unsigned int num_removed = 0;
+    XtVaSetValues (list->list_toggle_widgets[index], XmNpositionIndex, position, NULL);
+}
+
+void apply_sort_order (todo_list_t *list)
+{
+    unsigned order[MAX_TODOS];
     for (unsigned int i = 0; i < list->num_todo_items; i++) {
-        todo_item_t item = list->todo_items[i];
-        if (item.complete) {
-            XtUnmanageChild (list->list_toggle_widgets[i]);
-            list->list_toggle_widgets[i] = NULL;
-
-            // Delete file in store
-            todo_item_get_path (list, item, filepath, MAX_PATH_LEN);
-            unlink (filepath);
-            
-            // Remove item
-            num_removed++;
-            list->todo_items[i].id = ID_SENTINEL; // queue for deletion below
-            free (item.label_string);
-        }
-    }
-
-    // Close holes
-    // Not very efficient... would be better off with a doubly-linked list here. 
-    for (unsigned i = 0; i < list->num_todo_items; i++) {
-        if (list->todo_items[i].id == ID_SENTINEL) {
-            for (unsigned repl = i; repl < list->num_todo_items; repl++) {
-                list->todo_items[repl] = list->todo_items[repl + 1];
-                list->list_toggle_widgets[repl] = list->list_toggle_widgets[repl + 1];
-            }
+        order[i] = i;
+    }
 
-            list->num_todo_items--;
-            i--;
+    if (g_app_state.sort_by_due) {
+        // Insertion sort; lists are short
+        for (unsigned int i = 1; i < list->num_todo_items; i++) {
+            unsigned current = order[i];
+            int j = i - 1;
+            while (j >= 0 && todo_item_compare_due (list, order[j], current) > 0) {
+                order[j + 1] = order[j];
+                j--;
+            }
+            order[j + 1] = current;
         }
     }
+
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        XtVaSetValues (list->list_toggle_widgets[order[i]], XmNpositionIndex, i, NULL);
+    }
 }
 
-void list_reload_watcher_callback (XtPointer user_data, __unused XtIntervalId *id)
+todo_list_t* todo_list_for_id (unsigned long id)
 {
-    todo_list_t *list = (todo_list_t *)user_data;
-    reload_todos_for_list (list);
+    for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+        if (g_app_state.todo_lists[i].id == id) {
+            return &g_app_state.todo_lists[i];
+        }
+    }
+
+    return NULL;
 }
 
-void list_delete_watcher_callback (XtPointer user_data, __unused XtIntervalId *id)
+bool due_entry_is_live (due_entry_t entry)
 {
-    todo_list_t *list = (todo_list_t *)user_data;
+    todo_list_t *list = todo_list_for_id (entry.list_id);
+    if (list == NULL) {
+        return false;
+    }
 
+    int index = todo_item_index (list, entry.item_id);
+    return index >= 0
+           && !todo_list_item_is_complete (list, index)
+           && list->item_due_times[index] == entry.due_time;
 }
 
-void* file_watcher_thread_main (__unused void *context)
+void due_heap_sift_down (unsigned index)
 {
-    char buffer[FS_EVENT_BUFSIZE] __attribute__ ((aligned(8))) = { 0 };
+    due_entry_t *heap = g_app_state.due_heap;
     for (;;) {
-        ssize_t result = read (g_app_state.file_watch_inotify_fd, buffer, FS_EVENT_BUFSIZE);
-        if (result <= 0) {
-            fprintf (stderr, "File watcher inotify read error, exiting (%ld)\n", result);
-            break;
-        }
+        unsigned smallest = index;
+        unsigned left = 2 * index + 1;
+        unsigned right = left + 1;
+        if (left < g_app_state.num_due_entries && heap[left].due_time < heap[smallest].due_time) smallest = left;
+        if (right < g_app_state.num_due_entries && heap[right].due_time < heap[smallest].due_time) smallest = right;
+        if (smallest == index) break;
+
+        due_entry_t tmp = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = tmp;
+        index = smallest;
+    }
+}
 
-        struct inotify_event *event = (struct inotify_event *)buffer;
-        if (event == NULL) {
-            continue;
-        }
+void due_heap_pop ()
+{
+    g_app_state.due_heap[0] = g_app_state.due_heap[--g_app_state.num_due_entries];
+    due_heap_sift_down (0);
+}
 
-        // Locate relevant watch descriptor
-	todo_list_t *watched_list = NULL;
-        for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
-            todo_list_t *list = &g_app_state.todo_lists[i];
-            if (list->watch_descriptor == event->wd) {
-		watched_list = list;
-                break;
+void due_heap_push (due_entry_t entry)
+{
+    if (g_app_state.num_due_entries == MAX_DUE_ENTRIES) {
+        // Full of stale entries: drop them (and duplicates of live ones) and rebuild
+        unsigned num_live = 0;
+        for (unsigned int i = 0; i < g_app_state.num_due_entries; i++) {
+            due_entry_t entry = g_app_state.due_heap[i];
+            if (!due_entry_is_live (entry)) continue;
+
+            bool duplicate = false;
+            for (unsigned int j = 0; j < num_live && !duplicate; j++) {
+                duplicate = g_app_state.due_heap[j].list_id == entry.list_id
+                            && g_app_state.due_heap[j].item_id == entry.item_id;
             }
-        }
 
-	// Call the relevant callback 
-	if (watched_list) {
-	    XtTimerCallbackProc callback = list_reload_watcher_callback;
+            if (!duplicate) {
+                g_app_state.due_heap[num_live++] = entry;
+            }
+        }
 
-	    // IN_IGNORED: the watch was automatically removed because the file was deleted, 
-	    // or its filesystem was unmounted
-	    if (event->mask & IN_IGNORED) {
-	        callback = list_delete_watcher_callback;
-	    }
+        g_app_state.num_due_entries = num_live;
+        for (int i = (int) num_live / 2 - 1; i >= 0; i--) {
+            due_heap_sift_down (i);
+        }
 
-	    XtAppAddTimeOut (g_app_state.app, 1, callback, watched_list);
-	}
+        if (num_live == MAX_DUE_ENTRIES) {
+            fprintf (stderr, "Due date index is full\n");
+            return;
+        }
     }
 
-    return NULL;
+    due_entry_t *heap = g_app_state.due_heap;
+    unsigned index = g_app_state.num_due_entries++;
+    heap[index] = entry;
+    while (index > 0) {
+        unsigned parent = (index - 1) / 2;
+        if (heap[parent].due_time <= heap[index].due_time) break;
+
+        due_entry_t tmp = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = tmp;
+        index = parent;
+    }
 }
 
-int main (int argc, char *argv[])
+void due_timer_callback (XtPointer user_data, XtIntervalId *id);
+
+// (Re-)arm the one due timer for the earliest live deadline
+void arm_due_timer ()
+{
+    while (g_app_state.num_due_entries > 0 && !due_entry_is_live (g_app_state.due_heap[0])) {
+        due_heap_pop ();
+    }
+
+    if (g_app_state.num_due_entries == 0) {
+        if (g_app_state.due_timer) {
+            XtRemoveTimeOut (g_app_state.due_timer);
+            g_app_state.due_timer = 0;
+        }
+        return;
+    }
+
+    time_t deadline = g_app_state.due_heap[0].due_time;
+    if (g_app_state.due_timer) {
+        if (g_app_state.due_timer_deadline == deadline) {
+            return;
+        }
+        XtRemoveTimeOut (g_app_state.due_timer);
+    }
+
+    time_t now = time (NULL);
+    unsigned long delay_ms = (deadline > now) ? (unsigned long) (deadline - now) * 1000 : 0;
+    if (delay_ms > MAX_DUE_TIMER_MS) {
+        delay_ms = MAX_DUE_TIMER_MS;
+    }
+
+    g_app_state.due_timer_deadline = deadline;
+    g_app_state.due_timer = XtAppAddTimeOut (g_app_state.app, delay_ms, due_timer_callback, NULL);
+}
+
+void due_timer_callback (__unused XtPointer user_data, __unused XtIntervalId *id)
+{
+    g_app_state.due_timer = 0;
+
+    time_t now = time (NULL);
+    while (g_app_state.num_due_entries > 0 && g_app_state.due_heap[0].due_time <= now) {
+        due_entry_t entry = g_app_state.due_heap[0];
+        due_heap_pop ();
+
+        if (due_entry_is_live (entry)) {
+            todo_list_t *list = todo_list_for_id (entry.list_id);
+            update_todo_appearance (list, todo_item_index (list, entry.item_id));
+        }
+    }
+
+    arm_due_timer ();
+}
+
+void index_todo_due_date (todo_list_t *list, todo_item_t item)
+{
+    if (item.complete || item.due_time == 0) {
+        return;
+    }
+
+    due_entry_t entry = {
+        .due_time = item.due_time,
+        .list_id = list->id,
+        .item_id = item.id,
+    };
+    due_heap_push (entry);
+    arm_due_timer ();
+}
+
+void add_todo (todo_list_t *list, todo_item_t item)
+{
+    unsigned int index = list->num_todo_items++;
+    todo_list_set_item (list, index, item);
+
+    XmString label_string = todo_item_create_display_string (item);
+    Widget item_widget = NULL;
+    if (list->num_free_toggle_widgets > 0) {
+        // Reuse a pooled toggle; its callback is still attached
+        item_widget = list->free_toggle_widgets[--list->num_free_toggle_widgets];
+        XtVaSetValues (item_widget,
+                       XmNlabelString, label_string,
+                       XmNset, item.complete,
+                       XmNuserData, item.id,
+                       NULL);
+    } else {
+        item_widget = XmVaCreateToggleButton (list->list_widget, "item",
+                                              XmNlabelString, label_string,
+                                              XmNset, item.complete,
+                                              XmNuserData, item.id,
+                                              NULL);
+        XtAddCallback (item_widget, XmNvalueChangedCallback, toggle_item_callback, NULL);
+    }
+    XmStringFree (label_string);
+
+    list->list_toggle_widgets[index] = item_widget;
+
+    update_todo_position (list, index);
+    update_todo_appearance (list, index);
+    XtManageChild (item_widget);
+
+    index_todo_due_date (list, item);
+    mark_todo_list_changed (list);
+}
+
+// Replace an existing item in place, e.g. after its file changed on disk
+void update_todo (todo_list_t *list, unsigned index, todo_item_t item)
+{
+    todo_item_t existing_item = todo_list_get_item (list, index);
+    bool label_changed = strcmp (existing_item.label_string, item.label_string) != 0
+                         || existing_item.quantity != item.quantity
+                         || existing_item.due_time != item.due_time;
+    bool order_changed = existing_item.due_time != item.due_time
+                         || existing_item.priority != item.priority;
+    bool due_changed = existing_item.due_time != item.due_time
+                       || existing_item.complete != item.complete;
+
+    todo_item_free (existing_item);
+    todo_list_set_item (list, index, item);
+
+    Widget toggle_widget = list->list_toggle_widgets[index];
+    XmToggleButtonSetState (toggle_widget, item.complete, false);
+    if (label_changed) {
+        XmString label_string = todo_item_create_display_string (item);
+        XtVaSetValues (toggle_widget, XmNlabelString, label_string, NULL);
+        XmStringFree (label_string);
+    }
+
+    if (order_changed) {
+        update_todo_position (list, index);
+    }
+
+    update_todo_appearance (list, index);
+    if (due_changed) {
+        index_todo_due_date (list, item);
+    }
+
+    mark_todo_list_changed (list);
+}
+
+void recycle_toggle_widget (todo_list_t *list, Widget toggle_widget)
+{
+    XtUnmanageChild (toggle_widget);
+    XtVaSetValues (toggle_widget, XmNpositionIndex, XmLAST_POSITION, NULL);
+
+    // A list never holds more than MAX_TODOS toggles between live items and the pool
+    list->free_toggle_widgets[list->num_free_toggle_widgets++] = toggle_widget;
+}
+
+int todo_item_index (todo_list_t *list, unsigned long id)
+{
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        if (list->item_ids[i] == id) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void remove_todo_at_index (todo_list_t *list, unsigned index)
+{
+    recycle_toggle_widget (list, list->list_toggle_widgets[index]);
+
+    for (unsigned int i = index; i < list->num_todo_items - 1; i++) {
+        todo_list_move_item (list, i, i + 1);
+    }
+
+    list->num_todo_items--;
+    todo_list_truncate_complete_bits (list, list->num_todo_items);
+    mark_todo_list_changed (list);
+}
+
+int move_todo_item (todo_list_t *from_list, unsigned index, todo_list_t *to_list)
+{
+    if (to_list->num_todo_items >= MAX_TODOS) {
+        fprintf (stderr, "Destination list is full\n");
+        return -1;
+    }
+
+    char from_path[MAX_PATH_LEN];
+    char to_path[MAX_PATH_LEN];
+    todo_list_get_path (from_list, from_path, MAX_PATH_LEN);
+    todo_list_get_path (to_list, to_path, MAX_PATH_LEN);
+
+    int from_fd = open (from_path, O_RDONLY | O_DIRECTORY);
+    int to_fd = open (to_path, O_RDONLY | O_DIRECTORY);
+    if (from_fd == -1 || to_fd == -1) {
+        fprintf (stderr, "Unable to open list dirs for move: %s\n", strerror (errno));
+        if (from_fd != -1) close (from_fd);
+        if (to_fd != -1) close (to_fd);
+        return -1;
+    }
+
+    todo_item_t item = todo_list_get_item (from_list, index);
+
+    // Allocate the id in the destination list, skipping any file that appeared behind our back
+    char from_name[32];
+    char to_name[32];
+    unsigned long new_id = to_list->last_item_id;
+    do {
+        new_id++;
+        snprintf (to_name, sizeof (to_name), "%lu", new_id);
+    } while (faccessat (to_fd, to_name, F_OK, 0) == 0);
+
+    snprintf (from_name, sizeof (from_name), "%lu", item.id);
+    int result = renameat (from_fd, from_name, to_fd, to_name);
+    close (from_fd);
+    close (to_fd);
+
+    if (result != 0) {
+        fprintf (stderr, "Unable to move item %s: %s\n", from_name, strerror (errno));
+        return -1;
+    }
+
+    to_list->last_item_id = new_id;
+
+    // Move in memory; the item file is not reparsed
+    remove_todo_at_index (from_list, index);
+    item.id = new_id;
+    add_todo (to_list, item);
+
+    return 0;
+}
+
+void watch_todo_list (todo_list_t *list)
+{
+    // Start watching this directory for fs events
+    char list_path[MAX_PATH_LEN];
+    todo_list_get_path (list, list_path, MAX_PATH_LEN);
+    int result = inotify_add_watch (g_app_state.file_watch_inotify_fd, list_path, FS_WATCH_MASK);
+    if (result == -1) {
+        fprintf (stderr, "Error watching list dir: %s\n", strerror (errno));
+        return;
+    }
+
+    list->watch_descriptor = result;
+
+    // Watching an already watched directory returns the same descriptor
+    pthread_mutex_lock (&g_list_watches_lock);
+    unsigned int i = 0;
+    while (i < g_num_list_watches && g_list_watches[i].list_id != list->id) i++;
+    if (i < MAX_LISTS) {
+        g_list_watches[i].watch_descriptor = result;
+        g_list_watches[i].list_id = list->id;
+        if (i == g_num_list_watches) {
+            g_list_watches[i].reload_pending = false;
+            g_num_list_watches++;
+        }
+    }
+    pthread_mutex_unlock (&g_list_watches_lock);
+}
+
+void unwatch_todo_list (todo_list_t *list)
+{
+    // Followers never watched it
+    if (list->watch_descriptor <= 0) {
+        return;
+    }
+
+    inotify_rm_watch (g_app_state.file_watch_inotify_fd, list->watch_descriptor);
+    list->watch_descriptor = 0;
+
+    pthread_mutex_lock (&g_list_watches_lock);
+    for (unsigned int i = 0; i < g_num_list_watches; i++) {
+        if (g_list_watches[i].list_id == list->id) {
+            g_list_watches[i] = g_list_watches[--g_num_list_watches];
+            break;
+        }
+    }
+    pthread_mutex_unlock (&g_list_watches_lock);
+}
+
+// Watcher thread: 0 if the descriptor isn't (or is no longer) a list's
+unsigned long list_id_for_watch_descriptor (int wd)
+{
+    unsigned long list_id = 0;
+
+    pthread_mutex_lock (&g_list_watches_lock);
+    for (unsigned int i = 0; i < g_num_list_watches; i++) {
+        if (g_list_watches[i].watch_descriptor == wd) {
+            list_id = g_list_watches[i].list_id;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&g_list_watches_lock);
+
+    return list_id;
+}
+
+void add_todo_list (todo_list_t list)
+{
+    Widget notebook = g_app_state.notebook;
+
+    /* List View */
+    Widget list_scroll = XmVaCreateScrolledWindow (notebook, "scroller",
+                                                   XmNscrollingPolicy, XmAUTOMATIC,
+                                                   NULL);
+    XtManageChild (list_scroll);
+
+    Widget list_widget = XmVaCreateRowColumn (list_scroll, "list",
+                                              XmCNumColumns, 1,
+                                              XmCIsHomogeneous, true,
+                                              XmCEntryClass, xmToggleButtonWidgetClass,
+                                              NULL);
+    XtManageChild (list_widget);
+
+    list.list_widget = list_widget;
+
+    Widget tab = XmVaCreatePushButton (notebook, "tab",
+                                       XmNlabelString, list.list_name,
+                                       NULL);
+    XtManageChild (tab);
+
+    list.tab_button = tab;
+
+    unsigned index = g_app_state.num_todo_lists;
+    g_app_state.todo_lists[index] = list;
+    g_app_state.selected_list = &g_app_state.todo_lists[index];
+    g_app_state.num_todo_lists++;
+
+    // Followers get their items from the shared cache, and the owner watches the store for them
+    if (!shared_cache_is_follower ()) {
+        if (reload_todos_for_list (&g_app_state.todo_lists[index]) != 0) {
+            return;
+        }
+
+        watch_todo_list (&g_app_state.todo_lists[index]);
+    }
+
+    mark_todo_list_changed (&g_app_state.todo_lists[index]);
+}
+
+void archive_completed (todo_list_t *list, time_t min_age)
+{
+    char filepath[MAX_PATH_LEN];
+    gzFile archive = NULL;
+    time_t now = time (NULL);
+
+    // Pick archive candidates from the completed bits, a word at a time
+    uint64_t archive_bits[TODO_BITSET_WORDS] = { 0 };
+    time_t completed_times[MAX_TODOS];
+    bool any_archived = false;
+    for (unsigned int w = 0; w < TODO_BITSET_WORDS; w++) {
+        uint64_t word = list->complete_bits[w];
+        while (word != 0) {
+            unsigned index = w * 64 + __builtin_ctzll (word);
+            word &= word - 1;
+
+            // The item file is rewritten on every toggle, so its mtime is when it was checked off.
+            // Clearing (min_age 0) takes everything, even items whose file is already gone.
+            struct stat stat_buf = { 0 };
+            todo_item_get_path (list, todo_list_get_item (list, index), filepath, MAX_PATH_LEN);
+            bool have_stat = (stat (filepath, &stat_buf) == 0);
+            if (min_age == 0 || (have_stat && now - stat_buf.st_mtime >= min_age)) {
+                archive_bits[w] |= (uint64_t) 1 << (index % 64);
+                completed_times[index] = have_stat ? stat_buf.st_mtime : now;
+                any_archived = true;
+            }
+        }
+    }
+
+    if (!any_archived) {
+        return;
+    }
+
+    unsigned int num_kept = 0;
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        if (!((archive_bits[i / 64] >> (i % 64)) & 1)) {
+            // Close holes as we go
+            todo_list_move_item (list, num_kept++, i);
+            continue;
+        }
+
+        todo_item_t item = todo_list_get_item (list, i);
+
+        if (archive == NULL) {
+            // Each append adds a gzip member; readers see one concatenated stream
+            char archive_path[MAX_PATH_LEN];
+            todo_list_get_archive_path (list, archive_path, MAX_PATH_LEN);
+            archive = gzopen (archive_path, "ab");
+            if (archive == NULL) {
+                fprintf (stderr, "Unable to open archive for writing: %s\n", archive_path);
+            }
+        }
+
+        if (archive != NULL) {
+            gzprintf (archive, "%lld\t%s\n", (long long) completed_times[i], item.label_string);
+        }
+
+        recycle_toggle_widget (list, list->list_toggle_widgets[i]);
+
+        // Delete file in store
+        todo_item_get_path (list, item, filepath, MAX_PATH_LEN);
+        expect_own_write (list, item.id, IN_DELETE);
+        if (unlink (filepath) != 0) {
+            consume_own_write (list->id, item.id, IN_DELETE);
+        }
+
+        todo_item_free (item);
+    }
+
+    list->num_todo_items = num_kept;
+    todo_list_truncate_complete_bits (list, num_kept);
+    mark_todo_list_changed (list);
+
+    if (archive != NULL) {
+        gzclose (archive);
+    }
+}
+
+void clear_completed (todo_list_t *list)
+{
+    archive_completed (list, 0);
+}
+
+int todo_list_query_archive (todo_list_t *list, const char *match, archive_record_proc proc, void *context)
+{
+    char archive_path[MAX_PATH_LEN];
+    todo_list_get_archive_path (list, archive_path, MAX_PATH_LEN);
+
+    gzFile archive = gzopen (archive_path, "rb");
+    if (archive == NULL) {
+        return -1;
+    }
+
+    char line[ARCHIVE_LINE_LEN];
+    while (gzgets (archive, line, ARCHIVE_LINE_LEN) != NULL) {
+        line[strcspn (line, "\n")] = '\0';
+
+        char *label_string = strchr (line, '\t');
+        if (label_string == NULL) continue;
+        *label_string++ = '\0';
+
+        if (match == NULL || strcasestr (label_string, match) != NULL) {
+            time_t completed_time = (time_t) strtoll (line, NULL, 10);
+            proc (completed_time, label_string, context);
+        }
+    }
+
+    gzclose (archive);
+    return 0;
+}
+
+void archive_sweep_timer_callback (__unused XtPointer user_data, __unused XtIntervalId *id)
+{
+    if (g_app_state.resources.archive_age_hours <= 0) {
+        return;
+    }
+
+    // Only the instance that owns the store archives
+    if (!shared_cache_is_follower ()) {
+        time_t min_age = (time_t) g_app_state.resources.archive_age_hours * 60 * 60;
+        for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+            archive_completed (&g_app_state.todo_lists[i], min_age);
+        }
+    }
+
+    XtAppAddTimeOut (g_app_state.app, ARCHIVE_SWEEP_INTERVAL_MS, archive_sweep_timer_callback, NULL);
+}
+
+void list_reload_watcher_callback (XtPointer user_data, __unused XtIntervalId *id)
+{
+    unsigned long list_id = (unsigned long) user_data;
+
+    // Clear first, so changes made while rescanning schedule another one
+    pthread_mutex_lock (&g_list_watches_lock);
+    for (unsigned int i = 0; i < g_num_list_watches; i++) {
+        if (g_list_watches[i].list_id == list_id) {
+            g_list_watches[i].reload_pending = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&g_list_watches_lock);
+
+    // The list may have been forgotten since this was scheduled
+    todo_list_t *list = todo_list_for_id (list_id);
+    if (list != NULL) {
+        reload_todos_for_list (list);
+    }
+}
+
+// The list's watch is gone (directory deleted, or its filesystem unmounted)
+void list_delete_watcher_callback (XtPointer user_data, __unused XtIntervalId *id)
+{
+    // Already forgotten if we deleted it ourselves
+    todo_list_t *list = todo_list_for_id ((unsigned long) user_data);
+    if (list != NULL) {
+        forget_todo_list (list);
+    }
+}
+
+void item_move_watcher_callback (XtPointer user_data, __unused XtIntervalId *id)
+{
+    item_move_event_t *move = (item_move_event_t *)user_data;
+
+    todo_list_t *from_list = todo_list_for_id (move->from_list_id);
+    todo_list_t *to_list = todo_list_for_id (move->to_list_id);
+    if (from_list == NULL || to_list == NULL) {
+        // One side was forgotten in the meantime; rescan whatever is left
+        if (from_list != NULL) {
+            reload_todos_for_list (from_list);
+        } else if (to_list != NULL) {
+            reload_todos_for_list (to_list);
+        }
+
+        free (move);
+        return;
+    }
+
+    int index = todo_item_index (from_list, move->from_id);
+    int to_index = todo_item_index (to_list, move->to_id);
+    if (index < 0 && to_index >= 0) {
+        // Moves we made ourselves have already been applied in memory
+    } else if (index >= 0 && to_index < 0 && to_list->num_todo_items < MAX_TODOS) {
+        todo_item_t item = todo_list_get_item (from_list, index);
+        remove_todo_at_index (from_list, index);
+
+        item.id = move->to_id;
+        add_todo (to_list, item);
+    } else {
+        // Destination full, or the rename replaced an existing item: rescan both sides
+        // rather than leave an item behind whose file is gone
+        schedule_list_reload (from_list->id);
+        schedule_list_reload (to_list->id);
+    }
+
+    if (move->to_id > to_list->last_item_id) {
+        to_list->last_item_id = move->to_id;
+    }
+
+    free (move);
+}
+
+void store_reload_watcher_callback (__unused XtPointer user_data, __unused XtIntervalId *id)
+{
+    __atomic_store_n (&g_app_state.store_reload_pending, false, __ATOMIC_SEQ_CST);
+    reload_todo_lists ();
+}
+
+// Caller holds g_own_writes_lock
+void expire_own_writes (time_t now)
+{
+    unsigned int num_kept = 0;
+    for (unsigned int i = 0; i < g_num_own_writes; i++) {
+        if (g_own_writes[i].expires >= now) {
+            g_own_writes[num_kept++] = g_own_writes[i];
+        }
+    }
+    g_num_own_writes = num_kept;
+}
+
+// Call before writing or deleting an item file. Each write is expected to produce one event.
+void expect_own_write (todo_list_t *list, unsigned long item_id, uint32_t mask)
+{
+    // Followers don't watch the store
+    if (shared_cache_is_follower ()) {
+        return;
+    }
+
+    time_t now = time (NULL);
+    pthread_mutex_lock (&g_own_writes_lock);
+    expire_own_writes (now);
+
+    // If full, the event just causes a rescan
+    if (g_num_own_writes < MAX_OWN_WRITES) {
+        own_write_t own_write = {
+            .list_id = list->id,
+            .item_id = item_id,
+            .mask = mask,
+            .expires = now + OWN_WRITE_EXPIRY_S,
+        };
+        g_own_writes[g_num_own_writes++] = own_write;
+    }
+
+    pthread_mutex_unlock (&g_own_writes_lock);
+}
+
+// Returns true (and forgets the write) if the event is one this instance caused
+bool consume_own_write (unsigned long list_id, unsigned long item_id, uint32_t mask)
+{
+    bool found = false;
+
+    pthread_mutex_lock (&g_own_writes_lock);
+    expire_own_writes (time (NULL));
+    for (unsigned int i = 0; i < g_num_own_writes; i++) {
+        own_write_t *own_write = &g_own_writes[i];
+        if (own_write->list_id == list_id && own_write->item_id == item_id && (own_write->mask & mask)) {
+            g_own_writes[i] = g_own_writes[--g_num_own_writes];
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&g_own_writes_lock);
+
+    return found;
+}
+
+void schedule_list_reload (unsigned long list_id)
+{
+    // A burst of outside writes to one list only needs one rescan
+    bool already_pending = false;
+    pthread_mutex_lock (&g_list_watches_lock);
+    for (unsigned int i = 0; i < g_num_list_watches; i++) {
+        if (g_list_watches[i].list_id == list_id) {
+            already_pending = g_list_watches[i].reload_pending;
+            g_list_watches[i].reload_pending = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&g_list_watches_lock);
+
+    if (!already_pending) {
+        XtAppAddTimeOut (g_app_state.app, 1, list_reload_watcher_callback, (XtPointer) list_id);
+    }
+}
+
+void* file_watcher_thread_main (__unused void *context)
+{
+    char buffer[FS_EVENT_BUFSIZE] __attribute__ ((aligned(8))) = { 0 };
+
+    // Pending IN_MOVED_FROM, waiting for the IN_MOVED_TO with the same cookie
+    unsigned long moved_from_list_id = 0;
+    unsigned long moved_from_id = 0;
+    uint32_t      moved_from_cookie = 0;
+
+    for (;;) {
+        ssize_t result = read (g_app_state.file_watch_inotify_fd, buffer, FS_EVENT_BUFSIZE);
+        if (result <= 0) {
+            fprintf (stderr, "File watcher inotify read error, exiting (%ld)\n", result);
+            break;
+        }
+
+        char *cursor = buffer;
+        while (cursor < buffer + result) {
+            struct inotify_event *event = (struct inotify_event *)cursor;
+            cursor += sizeof (struct inotify_event) + event->len;
+
+            // Locate relevant watch descriptor
+            unsigned long watched_list_id = list_id_for_watch_descriptor (event->wd);
+
+            bool is_move_pair = (event->mask & IN_MOVED_TO)
+                                && moved_from_list_id != 0
+                                && event->cookie == moved_from_cookie;
+
+            if (moved_from_list_id && !is_move_pair) {
+                // Item was moved out of the store entirely
+                schedule_list_reload (moved_from_list_id);
+                moved_from_list_id = 0;
+            }
+
+            // Lists created, deleted or renamed, possibly by another instance
+            if (event->wd == g_app_state.store_watch_descriptor) {
+                if (event->len > 0 && event->name[0] != '.'
+                    && !__atomic_exchange_n (&g_app_state.store_reload_pending, true, __ATOMIC_SEQ_CST)) {
+                    XtAppAddTimeOut (g_app_state.app, 1, store_reload_watcher_callback, NULL);
+                }
+                continue;
+            }
+
+            if (watched_list_id == 0) {
+                continue;
+            }
+
+            // IN_IGNORED: the watch was automatically removed because the file was deleted,
+            // or its filesystem was unmounted
+            if (event->mask & IN_IGNORED) {
+                XtAppAddTimeOut (g_app_state.app, 1, list_delete_watcher_callback, (XtPointer) watched_list_id);
+                continue;
+            }
+
+            if ((event->mask & IN_MOVED_FROM) && event->len > 0 && event->name[0] != '.') {
+                moved_from_list_id = watched_list_id;
+                moved_from_id = strtoul (event->name, NULL, 10);
+                moved_from_cookie = event->cookie;
+                continue;
+            }
+
+            if (is_move_pair && event->len > 0 && event->name[0] != '.') {
+                // Both halves of a rename between (or within) watched lists: move the one
+                // item instead of reloading both lists.
+                item_move_event_t *move = malloc (sizeof (item_move_event_t));
+                move->from_list_id = moved_from_list_id;
+                move->from_id = moved_from_id;
+                move->to_list_id = watched_list_id;
+                move->to_id = strtoul (event->name, NULL, 10);
+                moved_from_list_id = 0;
+
+                XtAppAddTimeOut (g_app_state.app, 1, item_move_watcher_callback, move);
+                continue;
+            }
+
+            // Writes and deletes we made ourselves (toggles, control batches) are already applied
+            if ((event->mask & (IN_CLOSE_WRITE | IN_DELETE)) && event->len > 0
+                && consume_own_write (watched_list_id, strtoul (event->name, NULL, 10), event->mask)) {
+                continue;
+            }
+
+            schedule_list_reload (watched_list_id);
+        }
+
+        // The pair is normally queued back to back; don't wait on a later read for the other half
+        if (moved_from_list_id) {
+            schedule_list_reload (moved_from_list_id);
+            moved_from_list_id = 0;
+        }
+    }
+
+    return NULL;
+}
+
+bool shared_cache_is_follower ()
+{
+    return g_app_state.shared_cache != NULL && !g_app_state.shared_cache_owner;
+}
+
+void shared_cache_lock ()
+{
+    // Robust mutex: an instance that died holding the lock doesn't wedge the others
+    if (pthread_mutex_lock (&g_app_state.shared_cache->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent (&g_app_state.shared_cache->lock);
+    }
+}
+
+void shared_cache_unlock ()
+{
+    pthread_mutex_unlock (&g_app_state.shared_cache->lock);
+}
+
+// Call with the lock held
+void shared_cache_publish_list_locked (todo_list_t *list)
+{
+    shared_cache_t *cache = g_app_state.shared_cache;
+
+    shared_list_t *slot = NULL;
+    for (unsigned int i = 0; i < MAX_LISTS && slot == NULL; i++) {
+        if (cache->lists[i].id == list->id) slot = &cache->lists[i];
+    }
+    for (unsigned int i = 0; i < MAX_LISTS && slot == NULL; i++) {
+        if (cache->lists[i].id == 0) slot = &cache->lists[i];
+    }
+
+    if (slot == NULL) {
+        return;
+    }
+
+    char *list_name_chr = (char *) XmStringUnparse (list->list_name,
+                                                    NULL,
+                                                    XmCHARSET_TEXT,
+                                                    XmCHARSET_TEXT,
+                                                    NULL, 0, XmOUTPUT_ALL);
+    snprintf (slot->list_name, SHARED_LIST_NAME_LEN, "%s", list_name_chr);
+    XtFree (list_name_chr);
+
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        shared_item_t *shared_item = &slot->todo_items[i];
+        shared_item->id = list->item_ids[i];
+        shared_item->complete = todo_list_item_is_complete (list, i);
+        shared_item->due_time = list->item_due_times[i];
+        shared_item->quantity = list->item_quantities[i];
+        shared_item->priority = list->item_priorities[i];
+        snprintf (shared_item->label_string, SHARED_LABEL_LEN, "%s", list->item_labels[i]);
+    }
+
+    slot->id = list->id;
+    slot->num_todo_items = list->num_todo_items;
+    slot->last_item_id = list->last_item_id;
+    slot->generation = ++cache->generation;
+}
+
+Boolean list_changes_work_proc (__unused XtPointer client_data)
+{
+    g_app_state.list_changes_pending = false;
+
+    bool publish = g_app_state.shared_cache != NULL && g_app_state.shared_cache_owner;
+    if (publish) {
+        shared_cache_lock ();
+    }
+
+    for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+        todo_list_t *list = &g_app_state.todo_lists[i];
+        if (!list->changed) continue;
+
+        update_todo_list_tab (list);
+        if (publish) {
+            shared_cache_publish_list_locked (list);
+        }
+
+        list->changed = false;
+    }
+
+    if (publish) {
+        shared_cache_unlock ();
+    }
+
+    return True; // done, remove the work proc
+}
+
+void mark_todo_list_changed (todo_list_t *list)
+{
+    // Tab counts and the shared cache are refreshed once the current batch of changes is done,
+    // not per item
+    list->changed = true;
+    if (!g_app_state.list_changes_pending) {
+        g_app_state.list_changes_pending = true;
+        XtAppAddWorkProc (g_app_state.app, list_changes_work_proc, NULL);
+    }
+}
+
+void shared_cache_remove_list (unsigned long list_id)
+{
+    if (g_app_state.shared_cache == NULL || !g_app_state.shared_cache_owner) {
+        return;
+    }
+
+    shared_cache_t *cache = g_app_state.shared_cache;
+    shared_cache_lock ();
+    for (unsigned int i = 0; i < MAX_LISTS; i++) {
+        if (cache->lists[i].id == list_id) {
+            cache->lists[i].id = 0;
+            cache->generation++;
+        }
+    }
+    shared_cache_unlock ();
+}
+
+// Replaces everything in the cache with this instance's lists, in one locked step
+void shared_cache_publish_all ()
+{
+    shared_cache_t *cache = g_app_state.shared_cache;
+    shared_cache_lock ();
+
+    for (unsigned int i = 0; i < MAX_LISTS; i++) {
+        cache->lists[i].id = 0;
+    }
+
+    for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+        shared_cache_publish_list_locked (&g_app_state.todo_lists[i]);
+    }
+
+    cache->generation++;
+    shared_cache_unlock ();
+}
+
+bool todo_item_equal (todo_item_t a, todo_item_t b)
+{
+    return a.complete == b.complete
+           && a.due_time == b.due_time
+           && a.quantity == b.quantity
+           && a.priority == b.priority
+           && strcmp (a.label_string, b.label_string) == 0
+           && strcmp (a.extra_metadata ? a.extra_metadata : "", b.extra_metadata ? b.extra_metadata : "") == 0;
+}
+
+// Follower: bring one list's items in line with its published copy
+void shared_cache_apply_list (todo_list_t *list, shared_list_t *shared_list)
+{
+    bool seen_items[MAX_TODOS] = { false };
+    unsigned num_existing_items = list->num_todo_items;
+
+    for (unsigned int i = 0; i < shared_list->num_todo_items; i++) {
+        shared_item_t *shared_item = &shared_list->todo_items[i];
+        todo_item_t item = {
+            .complete = shared_item->complete,
+            .label_string = strdup (shared_item->label_string),
+            .id = shared_item->id,
+            .due_time = shared_item->due_time,
+            .quantity = shared_item->quantity,
+            .priority = shared_item->priority,
+        };
+
+        int existing_index = todo_item_index (list, item.id);
+        if (existing_index >= 0) {
+            seen_items[existing_index] = true;
+            if (todo_item_equal (todo_list_get_item (list, existing_index), item)) {
+                todo_item_free (item);
+            } else {
+                update_todo (list, existing_index, item);
+            }
+        } else if (list->num_todo_items < MAX_TODOS) {
+            add_todo (list, item);
+        } else {
+            todo_item_free (item);
+        }
+    }
+
+    for (int i = (int) num_existing_items - 1; i >= 0; i--) {
+        if (!seen_items[i]) {
+            todo_item_free (todo_list_get_item (list, i));
+            remove_todo_at_index (list, i);
+        }
+    }
+
+    if (shared_list->last_item_id > list->last_item_id) {
+        list->last_item_id = shared_list->last_item_id;
+    }
+
+    list->shared_generation = shared_list->generation;
+}
+
+// Follower: rebuild widgets only for lists whose generation moved since we last looked
+void shared_cache_sync ()
+{
+    shared_cache_t *cache = g_app_state.shared_cache;
+    if (__atomic_load_n (&cache->generation, __ATOMIC_SEQ_CST) == g_app_state.shared_cache_generation) {
+        return;
+    }
+
+    // Copy out only the changed lists so the owner isn't blocked while widgets are rebuilt
+    unsigned long published_ids[MAX_LISTS] = { 0 };
+    shared_list_t *changed_lists[MAX_LISTS] = { NULL };
+    unsigned num_changed_lists = 0;
+
+    shared_cache_lock ();
+    unsigned long generation = cache->generation;
+    for (unsigned int i = 0; i < MAX_LISTS; i++) {
+        shared_list_t *shared_list = &cache->lists[i];
+        published_ids[i] = shared_list->id;
+        if (shared_list->id == 0) continue;
+
+        todo_list_t *list = todo_list_for_id (shared_list->id);
+        if (list == NULL || list->shared_generation != shared_list->generation) {
+            shared_list_t *copy = malloc (sizeof (shared_list_t));
+            memcpy (copy, shared_list, sizeof (shared_list_t));
+            changed_lists[num_changed_lists++] = copy;
+        }
+    }
+    shared_cache_unlock ();
+
+    // Lists the owner no longer publishes
+    for (int i = (int) g_app_state.num_todo_lists - 1; i >= 0; i--) {
+        bool published = false;
+        for (unsigned int j = 0; j < MAX_LISTS && !published; j++) {
+            published = (published_ids[j] == g_app_state.todo_lists[i].id);
+        }
+
+        if (!published) {
+            forget_todo_list (&g_app_state.todo_lists[i]);
+        }
+    }
+
+    for (unsigned int i = 0; i < num_changed_lists; i++) {
+        shared_list_t *shared_list = changed_lists[i];
+        XmString list_name = XmStringCreateSimple (shared_list->list_name);
+
+        todo_list_t *list = todo_list_for_id (shared_list->id);
+        if (list == NULL && g_app_state.num_todo_lists < MAX_LISTS) {
+            todo_list_t new_list = { 0 };
+            new_list.id = shared_list->id;
+            new_list.list_name = XmStringCopy (list_name);
+            add_todo_list (new_list);
+
+            list = todo_list_for_id (shared_list->id);
+        } else if (list != NULL && !XmStringCompare (list->list_name, list_name)) {
+            set_todo_list_name (list, list_name);
+        }
+
+        if (list != NULL) {
+            shared_cache_apply_list (list, shared_list);
+        }
+
+        if (shared_list->id > g_app_state.last_todo_list_id) {
+            g_app_state.last_todo_list_id = shared_list->id;
+        }
+
+        XmStringFree (list_name);
+        free (shared_list);
+    }
+
+    g_app_state.shared_cache_generation = generation;
+}
+
+void start_watching_store ()
+{
+    pthread_create (&g_app_state.file_watch_thread, NULL, file_watcher_thread_main, NULL);
+
+    int result = inotify_add_watch (g_app_state.file_watch_inotify_fd, g_app_state.store_path, FS_STORE_WATCH_MASK);
+    if (result == -1) {
+        fprintf (stderr, "Error watching store dir: %s\n", strerror (errno));
+    } else {
+        g_app_state.store_watch_descriptor = result;
+    }
+}
+
+void shared_cache_poll_timer_callback (__unused XtPointer user_data, __unused XtIntervalId *id)
 {
+    shared_cache_t *cache = g_app_state.shared_cache;
+
+    // Take over loading and watching the store if its owner went away
+    pid_t owner_pid = __atomic_load_n (&cache->owner_pid, __ATOMIC_SEQ_CST);
+    if (owner_pid == 0 || (kill (owner_pid, 0) == -1 && errno == ESRCH)) {
+        shared_cache_lock ();
+        bool claimed = (cache->owner_pid == owner_pid);
+        if (claimed) {
+            cache->owner_pid = getpid ();
+        }
+        shared_cache_unlock ();
+
+        if (claimed) {
+            g_app_state.shared_cache_owner = true;
+
+            start_watching_store ();
+            reload_todo_lists ();
+            for (unsigned int i = 0; i < g_app_state.num_todo_lists; ) {
+                // A list whose directory is gone is forgotten, and the next one shifts into its slot
+                if (reload_todos_for_list (&g_app_state.todo_lists[i]) == 0) {
+                    watch_todo_list (&g_app_state.todo_lists[i]);
+                    i++;
+                }
+            }
+
+            shared_cache_publish_all ();
+
+            if (g_app_state.control_socket_fd <= 0) {
+                initialize_control_socket ();
+            }
+            return;
+        }
+    }
+
+    shared_cache_sync ();
+    XtAppAddTimeOut (g_app_state.app, SHARED_CACHE_POLL_MS, shared_cache_poll_timer_callback, NULL);
+}
+
+void shared_cache_cleanup ()
+{
+    // Let a follower take over right away
+    if (g_app_state.shared_cache_owner) {
+        __atomic_store_n (&g_app_state.shared_cache->owner_pid, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+void initialize_shared_cache ()
+{
+    char shm_name[NAME_MAX];
+    snprintf (shm_name, sizeof (shm_name), "/kitchentodo-%u", (unsigned) getuid ());
+
+    bool created = true;
+    int fd = shm_open (shm_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd == -1 && errno == EEXIST) {
+        created = false;
+        fd = shm_open (shm_name, O_RDWR, 0);
+    }
+
+    if (fd == -1) {
+        fprintf (stderr, "Unable to open shared cache, continuing without it: %s\n", strerror (errno));
+        return;
+    }
+
+    if (created && ftruncate (fd, sizeof (shared_cache_t)) != 0) {
+        fprintf (stderr, "Unable to size shared cache: %s\n", strerror (errno));
+        close (fd);
+        shm_unlink (shm_name);
+        return;
+    }
+
+    // The instance that created it may still be sizing it
+    struct stat stat_buf = { 0 };
+    for (int tries = 0; tries < 100; tries++) {
+        if (fstat (fd, &stat_buf) != 0 || stat_buf.st_size >= (off_t) sizeof (shared_cache_t)) break;
+        usleep (10 * 1000);
+    }
+
+    if (stat_buf.st_size != (off_t) sizeof (shared_cache_t)) {
+        fprintf (stderr, "Shared cache has an unexpected size, continuing without it\n");
+        close (fd);
+        return;
+    }
+
+    shared_cache_t *cache = mmap (NULL, sizeof (shared_cache_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (cache == MAP_FAILED) {
+        fprintf (stderr, "Unable to map shared cache: %s\n", strerror (errno));
+        return;
+    }
+
+    if (created) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init (&attr);
+        pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init (&cache->lock, &attr);
+        pthread_mutexattr_destroy (&attr);
+
+        cache->version = SHARED_CACHE_VERSION;
+        cache->owner_pid = getpid ();
+        __atomic_store_n (&cache->magic, SHARED_CACHE_MAGIC, __ATOMIC_SEQ_CST);
+    } else {
+        for (int tries = 0; tries < 100; tries++) {
+            if (__atomic_load_n (&cache->magic, __ATOMIC_SEQ_CST) == SHARED_CACHE_MAGIC) break;
+            usleep (10 * 1000);
+        }
+
+        if (cache->magic != SHARED_CACHE_MAGIC || cache->version != SHARED_CACHE_VERSION) {
+            fprintf (stderr, "Shared cache is from another version, continuing without it\n");
+            munmap (cache, sizeof (shared_cache_t));
+            return;
+        }
+    }
+
+    g_app_state.shared_cache = cache;
+    g_app_state.shared_cache_owner = created;
+    atexit (shared_cache_cleanup);
+}
+
+todo_list_t* todo_list_for_name (const char *name)
+{
+    // Lists may be addressed by id as well as by name
+    char *end = NULL;
+    unsigned long id = strtoul (name, &end, 10);
+    if (end != name && *end == '\0') {
+        todo_list_t *list = todo_list_for_id (id);
+        if (list) return list;
+    }
+
+    todo_list_t *found_list = NULL;
+    XmString list_name = XmStringCreateSimple ((char *) name);
+    for (unsigned int i = 0; i < g_app_state.num_todo_lists && !found_list; i++) {
+        if (XmStringCompare (g_app_state.todo_lists[i].list_name, list_name)) {
+            found_list = &g_app_state.todo_lists[i];
+        }
+    }
+    XmStringFree (list_name);
+
+    return found_list;
+}
+
+// Items are addressed as "#<id>", or by label (first match, incomplete items preferred)
+int control_find_item (todo_list_t *list, const char *item_ref)
+{
+    if (item_ref[0] == '#') {
+        return todo_item_index (list, strtoul (item_ref + 1, NULL, 10));
+    }
+
+    // Incomplete items first, then completed ones, walking the completion bitset a word at a time
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned int w = 0; w < TODO_BITSET_WORDS; w++) {
+            uint64_t word = (pass == 0) ? ~list->complete_bits[w] : list->complete_bits[w];
+            while (word != 0) {
+                unsigned index = w * 64 + __builtin_ctzll (word);
+                word &= word - 1;
+
+                if (index >= list->num_todo_items) break;
+                if (strcasecmp (list->item_labels[index], item_ref) == 0) {
+                    return index;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+// Applies one tab-separated command line. Returns NULL or an error message.
+const char* control_apply_command (char *line)
+{
+    char *fields[8] = { 0 };
+    unsigned num_fields = 0;
+    char *saveptr = NULL;
+    for (char *field = strtok_r (line, "\t", &saveptr);
+         field != NULL && num_fields < 8;
+         field = strtok_r (NULL, "\t", &saveptr)) {
+        fields[num_fields++] = field;
+    }
+
+    if (num_fields < 2) {
+        return "expected <command>\t<list>";
+    }
+
+    const char *command = fields[0];
+    todo_list_t *list = todo_list_for_name (fields[1]);
+    if (list == NULL) {
+        return "no such list";
+    }
+
+    if (strcmp (command, "add") == 0) {
+        // add <list> <label> [<key: value>...]
+        if (num_fields < 3) return "expected add\t<list>\t<label>";
+        if (list->num_todo_items >= MAX_TODOS) return "list is full";
+
+        todo_item_t item = {
+            .complete = false,
+            .label_string = strndup (fields[2], MAX_LABEL_LEN),
+            .id = ++list->last_item_id,
+        };
+        for (unsigned int i = 3; i < num_fields; i++) {
+            parse_todo_item_metadata (fields[i], &item);
+        }
+
+        add_todo (list, item);
+        write_todo_item_to_store (list, item);
+    } else if (strcmp (command, "complete") == 0 || strcmp (command, "uncomplete") == 0) {
+        // complete <list> <item>
+        if (num_fields < 3) return "expected complete\t<list>\t<item>";
+
+        int index = control_find_item (list, fields[2]);
+        if (index < 0) return "no such item";
+
+        todo_item_t item = todo_list_get_item (list, index);
+        item.complete = (command[0] == 'c');
+        item.label_string = strdup (item.label_string);
+        item.extra_metadata = item.extra_metadata ? strdup (item.extra_metadata) : NULL;
+        update_todo (list, index, item);
+        write_todo_item_to_store (list, item);
+    } else if (strcmp (command, "clear") == 0) {
+        // clear <list>
+        clear_completed (list);
+    } else if (strcmp (command, "move") == 0) {
+        // move <list> <item> <destination list>
+        if (num_fields < 4) return "expected move\t<list>\t<item>\t<list>";
+
+        int index = control_find_item (list, fields[2]);
+        if (index < 0) return "no such item";
+
+        todo_list_t *to_list = todo_list_for_name (fields[3]);
+        if (to_list == NULL) return "no such destination list";
+        if (to_list == list) return "item is already in that list";
+
+        if (move_todo_item (list, index, to_list) != 0) return "move failed";
+    } else {
+        return "unknown command";
+    }
+
+    return NULL;
+}
+
+void control_connection_close (control_connection_t *connection)
+{
+    XtRemoveInput (connection->input_id);
+    close (connection->fd);
+    free (connection->buffer);
+    free (connection);
+}
+
+void control_apply_batch (control_connection_t *connection)
+{
+    char reply[4096];
+    size_t reply_len = 0;
+    unsigned num_applied = 0;
+    unsigned line_number = 0;
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r (connection->buffer, "\n", &saveptr);
+         line != NULL;
+         line = strtok_r (NULL, "\n", &saveptr)) {
+        line_number++;
+        line[strcspn (line, "\r")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        const char *error = control_apply_command (line);
+        if (error == NULL) {
+            num_applied++;
+        } else if (reply_len < sizeof (reply)) {
+            reply_len += snprintf (reply + reply_len, sizeof (reply) - reply_len,
+                                   "error %u: %s\n", line_number, error);
+        }
+    }
+
+    if (reply_len < sizeof (reply)) {
+        reply_len += snprintf (reply + reply_len, sizeof (reply) - reply_len, "ok %u\n", num_applied);
+    }
+
+    if (reply_len > sizeof (reply)) {
+        reply_len = sizeof (reply);
+    }
+
+    // Best effort; the client may not be waiting for a reply
+    __unused ssize_t written = write (connection->fd, reply, reply_len);
+}
+
+void control_connection_readable (XtPointer client_data, __unused int *fd, __unused XtInputId *id)
+{
+    control_connection_t *connection = (control_connection_t *) client_data;
+
+    if (connection->buffer_capacity - connection->buffer_len < 1024) {
+        size_t capacity = connection->buffer_capacity * 2;
+        if (capacity > MAX_CONTROL_BATCH_LEN + 1) {
+            fprintf (stderr, "Control batch too large, dropping connection\n");
+            control_connection_close (connection);
+            return;
+        }
+
+        connection->buffer = realloc (connection->buffer, capacity);
+        connection->buffer_capacity = capacity;
+    }
+
+    ssize_t result = read (connection->fd, connection->buffer + connection->buffer_len,
+                           connection->buffer_capacity - connection->buffer_len - 1);
+    if (result < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+
+    if (result > 0) {
+        connection->buffer_len += result;
+        return;
+    }
+
+    // EOF (or error): the batch is complete. An empty one is a probe (see
+    // initialize_control_socket), and nobody is waiting for a reply.
+    if (result == 0 && connection->buffer_len > 0) {
+        connection->buffer[connection->buffer_len] = '\0';
+        control_apply_batch (connection);
+    }
+
+    control_connection_close (connection);
+}
+
+void control_socket_accept (__unused XtPointer client_data, __unused int *fd, __unused XtInputId *id)
+{
+    int client_fd = accept (g_app_state.control_socket_fd, NULL, NULL);
+    if (client_fd == -1) {
+        return;
+    }
+
+    fcntl (client_fd, F_SETFL, O_NONBLOCK);
+
+    control_connection_t *connection = calloc (1, sizeof (control_connection_t));
+    connection->fd = client_fd;
+    connection->buffer_capacity = 4096;
+    connection->buffer = malloc (connection->buffer_capacity);
+    connection->input_id = XtAppAddInput (g_app_state.app, client_fd, (XtPointer) XtInputReadMask,
+                                          control_connection_readable, connection);
+}
+
+void control_socket_cleanup ()
+{
+    if (g_app_state.control_socket_fd > 0) {
+        close (g_app_state.control_socket_fd);
+        unlink (g_app_state.control_socket_path);
+    }
+}
+
+void initialize_control_socket ()
+{
+    snprintf (g_app_state.control_socket_path, MAX_PATH_LEN, "%s/%s", g_app_state.store_path, CONTROL_SOCKET_NAME);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen (g_app_state.control_socket_path) >= sizeof (addr.sun_path)) {
+        fprintf (stderr, "Control socket path too long: %s\n", g_app_state.control_socket_path);
+        return;
+    }
+    strcpy (addr.sun_path, g_app_state.control_socket_path);
+
+    int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        fprintf (stderr, "Unable to create control socket: %s\n", strerror (errno));
+        return;
+    }
+
+    // Leave a socket that another running instance is serving alone
+    if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) == 0) {
+        fprintf (stderr, "Control socket already served by another instance\n");
+        close (fd);
+        return;
+    }
+
+    unlink (g_app_state.control_socket_path);
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0 || listen (fd, 8) != 0) {
+        fprintf (stderr, "Unable to listen on control socket: %s\n", strerror (errno));
+        close (fd);
+        return;
+    }
+
+    g_app_state.control_socket_fd = fd;
+    XtAppAddInput (g_app_state.app, fd, (XtPointer) XtInputReadMask, control_socket_accept, NULL);
+    atexit (control_socket_cleanup);
+}
+
+int main (int argc, char *argv[])
+{
+    // Control socket clients may hang up before reading their reply
+    signal (SIGPIPE, SIG_IGN);
+
     initialize_store_if_necessary ();
 
     /* Initialize Application */
@@ -551,29 +2479,40 @@ int main (int argc, char *argv[])
         NULL
     );
 
+    XtGetApplicationResources (toplevel, &g_app_state.resources,
+                               g_app_resources, XtNumber (g_app_resources), NULL, 0);
+
     /* Create root widget */
     Widget root = XtVaCreateManagedWidget ("main_window", xmMainWindowWidgetClass, toplevel, NULL);
     g_app_state.root_widget = root;
 
     /* Menu bar */
     Widget menubar = XmVaCreateSimpleMenuBar (root, "menubar",
-        XmVaCASCADEBUTTON, XmStringCreateSimple("File"), 'F',
-        XmVaCASCADEBUTTON, XmStringCreateSimple ("List"), 'L',
+        XmVaCASCADEBUTTON, temp_string ("File"), 'F',
+        XmVaCASCADEBUTTON, temp_string ("List"), 'L',
+        XmVaCASCADEBUTTON, temp_string ("View"), 'V',
         NULL
     );
 
     /* File menu */
     XmVaCreateSimplePulldownMenu (menubar, "file_menu", 0, file_menu_callback,
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Add Item..."), 'A', "Ctrl<Key>N", XmStringCreateSimple ("Ctrl+N"),
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Clear Completed"), 'C', "Ctrl<Key>X", XmStringCreateSimple ("Ctrl+X"),
+        XmVaPUSHBUTTON, temp_string ("Add Item..."), 'A', "Ctrl<Key>N", temp_string ("Ctrl+N"),
+        XmVaPUSHBUTTON, temp_string ("Move to List..."), 'M', "Ctrl<Key>M", temp_string ("Ctrl+M"),
+        XmVaPUSHBUTTON, temp_string ("Clear Completed"), 'C', "Ctrl<Key>X", temp_string ("Ctrl+X"),
         XmVaSEPARATOR,
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Quit"), 'Q', "Ctrl<Key>Q", XmStringCreateSimple ("Ctrl+Q"),
+        XmVaPUSHBUTTON, temp_string ("Quit"), 'Q', "Ctrl<Key>Q", temp_string ("Ctrl+Q"),
         NULL);
 
     XmVaCreateSimplePulldownMenu (menubar, "lists_menu", 1, list_menu_callback,
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Create List..."), 'C', NULL, NULL,
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Delete List..."), 'D', NULL, NULL,
-        XmVaPUSHBUTTON, XmStringCreateSimple ("Rename List..."), 'R', NULL, NULL,
+        XmVaPUSHBUTTON, temp_string ("Create List..."), 'C', NULL, NULL,
+        XmVaPUSHBUTTON, temp_string ("Delete List..."), 'D', NULL, NULL,
+        XmVaPUSHBUTTON, temp_string ("Rename List..."), 'R', NULL, NULL,
+        XmVaSEPARATOR,
+        XmVaPUSHBUTTON, temp_string ("Search History..."), 'H', NULL, NULL,
+        NULL);
+
+    XmVaCreateSimplePulldownMenu (menubar, "view_menu", 2, view_menu_callback,
+        XmVaCHECKBUTTON, temp_string ("Sort by Due Date"), 'D', NULL, NULL,
         NULL);
 
     XtManageChild (menubar);
@@ -588,7 +2527,7 @@ int main (int argc, char *argv[])
     /* Important to make sure this button is managed before the list scroll, so the list scroll can */
     /* reference the add button as its "bottom widget". */
     Widget add_button = XmVaCreatePushButton (main_form, "add_button",
-                                              XmNlabelString, XmStringCreateSimple ("+ Add Item"),
+                                              XmNlabelString, temp_string ("+ Add Item"),
                                               XmNleftAttachment, XmATTACH_FORM,
                                               XmNrightAttachment, XmATTACH_FORM,
                                               XmNbottomAttachment, XmATTACH_FORM,
@@ -596,6 +2535,8 @@ int main (int argc, char *argv[])
     XtAddCallback (add_button, XmNactivateCallback, add_menu_callback, NULL);
     XtManageChild (add_button);
 
+    free_temp_strings ();
+
     /* Notebook */
     Widget notebook = XmVaCreateNotebook (main_form, "notebook",
                                           XmNorientation, XmVERTICAL,
@@ -617,9 +2558,27 @@ int main (int argc, char *argv[])
 
     // Set up file watcher
     g_app_state.file_watch_inotify_fd = inotify_init ();
-    pthread_create (&g_app_state.file_watch_thread, NULL, file_watcher_thread_main, NULL);
 
-    reload_todo_lists ();
+    if (g_app_state.resources.shared_cache) {
+        initialize_shared_cache ();
+    }
+
+    if (shared_cache_is_follower ()) {
+        // Another instance loads and watches the store; build from its parsed lists
+        shared_cache_poll_timer_callback (NULL, NULL);
+    } else {
+        start_watching_store ();
+        reload_todo_lists ();
+
+        if (g_app_state.shared_cache) {
+            shared_cache_publish_all ();
+        }
+    }
+
+    initialize_control_socket ();
+
+    // Archive stale completed items now, then periodically
+    archive_sweep_timer_callback (NULL, NULL);
 
     XtRealizeWidget (toplevel);
     XtAppMainLoop (g_app_state.app);
@@ -633,18 +2592,27 @@ int main (int argc, char *argv[])
 
 Widget show_textfield_dialog (XmString title, XmString prompt, XtCallbackProc ok_callback)
 {
-    Arg args[] = {
-        { XmNselectionLabelString, (XtArgVal) prompt },
-        { XmNdialogTitle, (XtArgVal) title }
-    };
+    Widget dialog = g_app_state.textfield_dialog;
+    if (dialog == NULL) {
+        dialog = XmCreatePromptDialog (g_app_state.root_widget, "dialog", NULL, 0);
 
-    Widget dialog = XmCreatePromptDialog (g_app_state.root_widget, "dialog", args, 2);
+        // Delete "Help" button
+        XtUnmanageChild (XmSelectionBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
 
-    // Done callback
-    XtAddCallback (dialog, XmNokCallback, ok_callback, NULL);
+        g_app_state.textfield_dialog = dialog;
+    }
 
-    // Delete "Help" button
-    XtUnmanageChild (XmSelectionBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
+    XmString empty_string = XmStringCreateSimple ("");
+    XtVaSetValues (dialog,
+                   XmNselectionLabelString, prompt,
+                   XmNdialogTitle, title,
+                   XmNtextString, empty_string,
+                   NULL);
+    XmStringFree (empty_string);
+
+    // Done callback; the dialog is shared, so replace whatever the last user installed
+    XtRemoveAllCallbacks (dialog, XmNokCallback);
+    XtAddCallback (dialog, XmNokCallback, ok_callback, NULL);
 
     XtManageChild (dialog);
     XtPopup (XtParent (dialog), XtGrabNone);
@@ -654,25 +2622,86 @@ Widget show_textfield_dialog (XmString title, XmString prompt, XtCallbackProc ok
 
 void show_delete_list_dialog ()
 {
-    Arg args[] = {
-        { XmNdialogTitle, (XtArgVal) XmStringCreateSimple ("Delete List") },
-        { XmNmessageString, (XtArgVal) XmStringCreateSimple ("Are you sure?") },
-    };
+    Widget dialog = g_app_state.delete_list_dialog;
+    if (dialog == NULL) {
+        Arg args[] = {
+            { XmNdialogTitle, (XtArgVal) temp_string ("Delete List") },
+            { XmNmessageString, (XtArgVal) temp_string ("Are you sure?") },
+        };
+
+        dialog = XmCreateMessageDialog (g_app_state.root_widget, "dialog", args, 2);
+        free_temp_strings ();
+
+        // Done callback
+        XtAddCallback (dialog, XmNokCallback, delete_list_completion, NULL);
+
+        // Remove help button
+        XtUnmanageChild (XmMessageBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
+
+        g_app_state.delete_list_dialog = dialog;
+    }
+
+    XtManageChild (dialog);
+    XtPopup (XtParent (dialog), XtGrabNone);
+}
+
+Widget show_selection_dialog (Widget *dialog_cache, XmString title, XmString prompt,
+                              XmString *items, int num_items, XtCallbackProc ok_callback)
+{
+    Widget dialog = *dialog_cache;
+    if (dialog == NULL) {
+        Arg args[] = {
+            { XmNmustMatch, (XtArgVal) true },
+        };
+
+        dialog = XmCreateSelectionDialog (g_app_state.root_widget, "dialog", args, 1);
+
+        // Done callback
+        XtAddCallback (dialog, XmNokCallback, ok_callback, NULL);
 
-    Widget dialog = XmCreateMessageDialog (g_app_state.root_widget, "dialog", args, 2);
+        // Only picking from the list is allowed
+        XtUnmanageChild (XmSelectionBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
+        XtUnmanageChild (XmSelectionBoxGetChild (dialog, XmDIALOG_TEXT));
+        XtUnmanageChild (XmSelectionBoxGetChild (dialog, XmDIALOG_SELECTION_LABEL));
 
-    // Done callback
-    XtAddCallback (dialog, XmNokCallback, delete_list_completion, NULL);
+        *dialog_cache = dialog;
+    }
 
-    // Remove help button
-    XtUnmanageChild (XmMessageBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
+    XtVaSetValues (dialog,
+                   XmNlistLabelString, prompt,
+                   XmNdialogTitle, title,
+                   XmNlistItems, items,
+                   XmNlistItemCount, num_items,
+                   NULL);
 
     XtManageChild (dialog);
     XtPopup (XtParent (dialog), XtGrabNone);
+
+    return dialog;
+}
+
+// Returns the 0-indexed selected row of a selection dialog's list, or -1
+int selection_dialog_get_selected_index (Widget dialog)
+{
+    int *positions = NULL;
+    int num_positions = 0;
+    int index = -1;
+
+    Widget list = XmSelectionBoxGetChild (dialog, XmDIALOG_LIST);
+    if (XmListGetSelectedPos (list, &positions, &num_positions) && num_positions > 0) {
+        index = positions[0] - 1; // 1 indexed
+    }
+
+    XtFree ((char *) positions);
+    return index;
 }
 
 void show_rename_dialog ()
 {
+    if (g_app_state.selected_list == NULL) {
+        return;
+    }
+
     XmString title = XmStringCreateSimple ("Rename List");
     XmString prompt = XmStringCreateSimple ("List Name: ");
     Widget dialog = show_textfield_dialog (title, prompt, rename_list_completion);
@@ -690,7 +2719,11 @@ void file_menu_callback(__unused Widget w,
     if (selected_item == FILE_MENU_ADD_ITEM) {
         add_menu_callback (w, client_data, call_data);
     } else if (selected_item == FILE_MENU_CLEAR_COMPLETED) {
-        clear_completed (g_app_state.selected_list);
+        if (g_app_state.selected_list != NULL) {
+            clear_completed (g_app_state.selected_list);
+        }
+    } else if (selected_item == FILE_MENU_MOVE_ITEM) {
+        move_menu_callback (w, client_data, call_data);
     } else {
         // Quit
         exit (0);
@@ -721,7 +2754,12 @@ void add_menu_completion (__unused Widget w,
                                              XmCHARSET_TEXT,
                                              NULL, 0, XmOUTPUT_ALL);
 
-    if (strlen (item_string) > 0) {
+    if (strlen (item_string) > 0 && g_app_state.selected_list != NULL) {
+        // Longer labels wouldn't read back from the item file in one piece
+        if (strlen (item_string) > MAX_LABEL_LEN) {
+            item_string[MAX_LABEL_LEN] = '\0';
+        }
+
         g_app_state.selected_list->last_item_id++;
         todo_item_t item = {
             .complete = false,
@@ -730,6 +2768,88 @@ void add_menu_completion (__unused Widget w,
         };
         add_todo (g_app_state.selected_list, item);
         write_todo_item_to_store (g_app_state.selected_list, item);
+    } else {
+        XtFree (item_string);
+    }
+}
+
+void move_menu_callback (__unused Widget w,
+                         __unused XtPointer client_data,
+                         __unused XtPointer call_data)
+{
+    todo_list_t *list = g_app_state.selected_list;
+    if (list == NULL || list->num_todo_items == 0 || g_app_state.num_todo_lists < 2) {
+        return;
+    }
+
+    g_app_state.moving_list_id = list->id;
+
+    XmString items[MAX_TODOS];
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        items[i] = XmStringCreateSimple (list->item_labels[i]);
+        g_app_state.move_item_ids[i] = list->item_ids[i];
+    }
+
+    XmString title = XmStringCreateSimple ("Move to List");
+    XmString prompt = XmStringCreateSimple ("Item: ");
+    show_selection_dialog (&g_app_state.move_item_dialog, title, prompt,
+                           items, list->num_todo_items, move_item_selected);
+
+    XmStringFree (title);
+    XmStringFree (prompt);
+    for (unsigned int i = 0; i < list->num_todo_items; i++) {
+        XmStringFree (items[i]);
+    }
+}
+
+void move_item_selected (Widget w,
+                         __unused XtPointer client_data,
+                         __unused XtPointer call_data)
+{
+    // Not the selected list: the user may have switched tabs while the dialog was up
+    todo_list_t *list = todo_list_for_id (g_app_state.moving_list_id);
+
+    int index = selection_dialog_get_selected_index (w);
+    if (list == NULL || index < 0 || (unsigned) index >= MAX_TODOS) {
+        return;
+    }
+
+    g_app_state.moving_item_id = g_app_state.move_item_ids[index];
+
+    XmString list_names[MAX_LISTS];
+    int num_list_names = 0;
+    for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+        todo_list_t *other = &g_app_state.todo_lists[i];
+        if (other == list) continue;
+        g_app_state.move_destination_ids[num_list_names] = other->id;
+        list_names[num_list_names++] = other->list_name;
+    }
+    g_app_state.num_move_destinations = num_list_names;
+
+    XmString title = XmStringCreateSimple ("Move to List");
+    XmString prompt = XmStringCreateSimple ("Destination: ");
+    show_selection_dialog (&g_app_state.move_list_dialog, title, prompt,
+                           list_names, num_list_names, move_list_selected);
+
+    XmStringFree (title);
+    XmStringFree (prompt);
+}
+
+void move_list_selected (Widget w,
+                         __unused XtPointer client_data,
+                         __unused XtPointer call_data)
+{
+    todo_list_t *from_list = todo_list_for_id (g_app_state.moving_list_id);
+
+    int row = selection_dialog_get_selected_index (w);
+    todo_list_t *to_list = NULL;
+    if (row >= 0 && (unsigned) row < g_app_state.num_move_destinations) {
+        to_list = todo_list_for_id (g_app_state.move_destination_ids[row]);
+    }
+
+    int index = (from_list != NULL) ? todo_item_index (from_list, g_app_state.moving_item_id) : -1;
+    if (to_list != NULL && index >= 0) {
+        move_todo_item (from_list, index, to_list);
     }
 }
 
@@ -742,18 +2862,32 @@ void toggle_item_callback (Widget w,
 
     todo_list_t *list = g_app_state.selected_list;
 
-    todo_item_t *item = NULL;
-    for (unsigned int i = 0; i < list->num_todo_items; i++) {
-        if (list->todo_items[i].id == item_id) {
-            item = &list->todo_items[i];
-            break;
-        }
+    int index = (list != NULL) ? todo_item_index (list, item_id) : -1;
+    if (index >= 0) {
+        XmToggleButtonCallbackStruct *cbs = (XmToggleButtonCallbackStruct *) call_data;
+        todo_list_set_item_complete (list, index, cbs->set);
+
+        todo_item_t item = todo_list_get_item (list, index);
+        write_todo_item_to_store (list, item);
+
+        update_todo_appearance (list, index);
+        index_todo_due_date (list, item);
+        mark_todo_list_changed (list);
     }
+}
 
-    if (item != NULL) {
+void view_menu_callback (__unused Widget w,
+                         XtPointer client_data,
+                         XtPointer call_data)
+{
+    unsigned long selected_item = (unsigned long) client_data;
+    if (selected_item == VIEW_MENU_SORT_BY_DUE) {
         XmToggleButtonCallbackStruct *cbs = (XmToggleButtonCallbackStruct *) call_data;
-        item->complete = cbs->set;
-        write_todo_item_to_store (g_app_state.selected_list, *item);
+        g_app_state.sort_by_due = cbs->set;
+
+        for (unsigned int i = 0; i < g_app_state.num_todo_lists; i++) {
+            apply_sort_order (&g_app_state.todo_lists[i]);
+        }
     }
 }
 
@@ -775,7 +2909,9 @@ void notebook_page_changed_callback (__unused Widget w,
         }
     }
 
-    g_app_state.selected_list = &g_app_state.todo_lists[todo_list_idx];
+    if (g_app_state.num_todo_lists > 0) {
+        g_app_state.selected_list = &g_app_state.todo_lists[todo_list_idx];
+    }
 }
 
 void list_menu_callback (Widget w, XtPointer client_data, XtPointer call_data)
@@ -787,6 +2923,8 @@ void list_menu_callback (Widget w, XtPointer client_data, XtPointer call_data)
         show_delete_list_dialog ();
     } else if (selected_item == LISTS_MENU_RENAME_LIST) {
         show_rename_dialog ();
+    } else if (selected_item == LISTS_MENU_SEARCH_HISTORY) {
+        search_history_callback (w, client_data, call_data);
     }
 }
 
@@ -822,7 +2960,9 @@ void delete_list_completion (__unused Widget w,
                              __unused XtPointer client_data,
                              __unused XtPointer call_data)
 {
-    delete_todo_list (g_app_state.selected_list);
+    if (g_app_state.selected_list != NULL) {
+        delete_todo_list (g_app_state.selected_list);
+    }
 }
 
 void rename_list_completion (__unused Widget w,
@@ -830,5 +2970,96 @@ void rename_list_completion (__unused Widget w,
                              __unused XtPointer call_data)
 {
     XmSelectionBoxCallbackStruct *cbs = (XmSelectionBoxCallbackStruct *) call_data;
-    rename_todo_list (g_app_state.selected_list, cbs->value);
+    if (g_app_state.selected_list != NULL) {
+        rename_todo_list (g_app_state.selected_list, cbs->value);
+    }
+}
+
+typedef struct _history_results_t {
+    time_t        completed_times[HISTORY_MAX_RESULTS];
+    char         *label_strings[HISTORY_MAX_RESULTS];
+    unsigned      num_matches;
+} history_results_t;
+
+void collect_history_record (time_t completed_time, const char *label_string, void *context)
+{
+    history_results_t *results = (history_results_t *) context;
+
+    // Ring buffer: records arrive oldest first, keep the most recent ones
+    unsigned slot = results->num_matches++ % HISTORY_MAX_RESULTS;
+    free (results->label_strings[slot]);
+    results->label_strings[slot] = strdup (label_string);
+    results->completed_times[slot] = completed_time;
+}
+
+void search_history_callback (__unused Widget w,
+                              __unused XtPointer client_data,
+                              __unused XtPointer call_data)
+{
+    XmString title = XmStringCreateSimple ("Search History");
+    XmString prompt = XmStringCreateSimple ("Item Name: ");
+    show_textfield_dialog (title, prompt, search_history_completion);
+
+    XmStringFree (title);
+    XmStringFree (prompt);
+}
+
+void search_history_completion (__unused Widget w,
+                                __unused XtPointer client_data,
+                                XtPointer call_data)
+{
+    XmSelectionBoxCallbackStruct *cbs = (XmSelectionBoxCallbackStruct *) call_data;
+    if (g_app_state.selected_list == NULL) {
+        return;
+    }
+
+    char *match = (char *) XmStringUnparse (cbs->value,
+                                            XmFONTLIST_DEFAULT_TAG,
+                                            XmCHARSET_TEXT,
+                                            XmCHARSET_TEXT,
+                                            NULL, 0, XmOUTPUT_ALL);
+
+    history_results_t results = { 0 };
+    todo_list_query_archive (g_app_state.selected_list, match, collect_history_record, &results);
+    XtFree (match);
+
+    // Newest first
+    char message[HISTORY_MAX_RESULTS * 128] = "No matching items in history.";
+    size_t message_len = 0;
+    unsigned num_shown = results.num_matches < HISTORY_MAX_RESULTS ? results.num_matches : HISTORY_MAX_RESULTS;
+    for (unsigned i = 0; i < num_shown; i++) {
+        unsigned slot = (results.num_matches - 1 - i) % HISTORY_MAX_RESULTS;
+
+        char date[32];
+        strftime (date, sizeof (date), "%a %b %e %Y", localtime (&results.completed_times[slot]));
+        message_len += snprintf (message + message_len, sizeof (message) - message_len,
+                                 "%s%s  %s", (i > 0 ? "\n" : ""), date, results.label_strings[slot]);
+        if (message_len >= sizeof (message)) break;
+    }
+
+    for (unsigned i = 0; i < HISTORY_MAX_RESULTS; i++) {
+        free (results.label_strings[i]);
+    }
+
+    Widget dialog = g_app_state.history_dialog;
+    if (dialog == NULL) {
+        Arg args[] = {
+            { XmNdialogTitle, (XtArgVal) temp_string ("History") },
+        };
+
+        dialog = XmCreateInformationDialog (g_app_state.root_widget, "dialog", args, 1);
+        free_temp_strings ();
+
+        XtUnmanageChild (XmMessageBoxGetChild (dialog, XmDIALOG_HELP_BUTTON));
+        XtUnmanageChild (XmMessageBoxGetChild (dialog, XmDIALOG_CANCEL_BUTTON));
+
+        g_app_state.history_dialog = dialog;
+    }
+
+    XmString message_string = XmStringCreateLtoR (message, XmFONTLIST_DEFAULT_TAG);
+    XtVaSetValues (dialog, XmNmessageString, message_string, NULL);
+    XmStringFree (message_string);
+
+    XtManageChild (dialog);
+    XtPopup (XtParent (dialog), XtGrabNone);
 }